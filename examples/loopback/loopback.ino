@@ -23,13 +23,10 @@ void loop() {
     usbSerial.write((uint8_t*)message, 15);
   }
 
-  // echo received data
-  if (usbSerial.available()) {
-    uint8_t buff[256];
-    std::size_t len = 0;
-    while (usbSerial.available() && len > 0) {
-      len += usbSerial.read(&buff[len], 256 - len);
-    }
+  // echo received data, wait up to 100ms for it to arrive
+  uint8_t buff[256];
+  std::size_t len = usbSerial.read(buff, 256, 100);
+  if (len > 0) {
     usbSerial.write(buff, len);
   }
 }
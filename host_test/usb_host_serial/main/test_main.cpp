@@ -0,0 +1,30 @@
+/*
+Copyright (c) 2024 Bert Melis. All rights reserved.
+
+This work is licensed under the terms of the MIT license.
+For a copy, see <https://opensource.org/licenses/MIT> or
+the LICENSE file.
+*/
+
+#include <stdio.h>
+#include <catch2/catch_session.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+
+extern "C" void app_main(void)
+{
+    int argc = 1;
+    const char *argv[2] = {
+        "target_test_main",
+        NULL
+    };
+
+    auto result = Catch::Session().run(argc, argv);
+    if (result != 0) {
+        printf("Test failed with result %d\n", result);
+    } else {
+        printf("Test passed.\n");
+    }
+    fflush(stdout);
+    exit(result);
+}
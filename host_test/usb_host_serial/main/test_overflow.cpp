@@ -0,0 +1,65 @@
+/*
+Copyright (c) 2024 Bert Melis. All rights reserved.
+
+This work is licensed under the terms of the MIT license.
+For a copy, see <https://opensource.org/licenses/MIT> or
+the LICENSE file.
+*/
+
+#include <string.h>
+#include <catch2/catch_test_macros.hpp>
+
+#include "test_serial.hpp"
+
+SCENARIO("RX overflow policies")
+{
+    uint8_t transfer[USBHOSTSERIAL_BUFFERSIZE];
+    for (size_t i = 0; i < sizeof(transfer); ++i) {
+        transfer[i] = i & 0xFF;
+    }
+    uint8_t out[USBHOSTSERIAL_BUFFERSIZE];
+
+    GIVEN("A full RX buffer") {
+        TestSerial *serial = new TestSerial();
+        REQUIRE(TestSerial::_handle_rx(transfer, sizeof(transfer), serial));
+
+        SECTION("DROP_OLDEST keeps the newest data") {
+            serial->setOverflowPolicy(USBHostSerialOverflow::DROP_OLDEST);
+            const uint8_t newest[4] = {0xA0, 0xA1, 0xA2, 0xA3};
+            REQUIRE(TestSerial::_handle_rx(newest, sizeof(newest), serial));
+            REQUIRE(serial->rxDropped() == sizeof(newest));
+            REQUIRE(serial->available() == sizeof(transfer));
+
+            REQUIRE(serial->read(out, sizeof(out)) == sizeof(out));
+            REQUIRE(memcmp(out, transfer + sizeof(newest), sizeof(transfer) - sizeof(newest)) == 0);
+            REQUIRE(memcmp(out + sizeof(transfer) - sizeof(newest), newest, sizeof(newest)) == 0);
+        }
+
+        SECTION("DROP_OLDEST under a lent block is reported by consume()") {
+            serial->setOverflowPolicy(USBHostSerialOverflow::DROP_OLDEST);
+            const uint8_t *span = nullptr;
+            REQUIRE(serial->readSpan(&span) == sizeof(transfer));
+            REQUIRE(TestSerial::_handle_rx(transfer, 8, serial));
+            REQUIRE_FALSE(serial->consume(16));
+            REQUIRE(serial->available() == sizeof(transfer) - 16 + 8);
+            REQUIRE(serial->rxDropped() == 8);
+        }
+
+        SECTION("An untouched lent block is consumed normally") {
+            const uint8_t *span = nullptr;
+            REQUIRE(serial->readSpan(&span) == sizeof(transfer));
+            REQUIRE(serial->consume(16));
+            REQUIRE(serial->available() == sizeof(transfer) - 16);
+        }
+
+        SECTION("BACKPRESSURE without a device drops the newest data") {
+            serial->setOverflowPolicy(USBHostSerialOverflow::BACKPRESSURE);
+            REQUIRE(TestSerial::_handle_rx(transfer, 10, serial));
+            REQUIRE(serial->rxDropped() == 10);
+            REQUIRE(serial->read(out, sizeof(out)) == sizeof(out));
+            REQUIRE(memcmp(out, transfer, sizeof(out)) == 0);
+        }
+
+        delete serial;
+    }
+}
@@ -0,0 +1,233 @@
+/*
+Copyright (c) 2024 Bert Melis. All rights reserved.
+
+This work is licensed under the terms of the MIT license.
+For a copy, see <https://opensource.org/licenses/MIT> or
+the LICENSE file.
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include <catch2/catch_test_macros.hpp>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "freertos/ringbuf.h"
+
+#include "USBHostSerialRingbuf.h"
+
+static constexpr std::size_t bench_ring_size = 1024;
+static constexpr std::size_t bench_chunk = 64;         // a full speed bulk packet
+static constexpr std::size_t bench_total = 1 << 20;    // bytes moved from producer to consumer
+static constexpr int bench_single_ops = 100000;        // write/read pairs in one task
+
+/**
+ * @brief The lock-free SPSC ring that USBHostSerial uses
+ */
+class SpscRing {
+public:
+    std::size_t write(const uint8_t *data, std::size_t len) {
+        return _ring.write(data, len);
+    }
+
+    std::size_t read(uint8_t *dest, std::size_t len) {
+        return _ring.read(dest, len);
+    }
+
+private:
+    USBHostSerialRingbuf<bench_ring_size> _ring;
+};
+
+/**
+ * @brief FreeRTOS byte buffer, used the way USBHostSerial used it before
+ */
+class FreeRTOSRing {
+public:
+    FreeRTOSRing()
+    : _handle(xRingbufferCreate(bench_ring_size, RINGBUF_TYPE_BYTEBUF)) {
+        assert(_handle);
+    }
+
+    ~FreeRTOSRing() {
+        vRingbufferDelete(_handle);
+    }
+
+    std::size_t write(const uint8_t *data, std::size_t len) {
+        // all or nothing
+        return (xRingbufferSend(_handle, data, len, 0) == pdTRUE) ? len : 0;
+    }
+
+    std::size_t read(uint8_t *dest, std::size_t len) {
+        std::size_t size = 0;
+        void *item = xRingbufferReceiveUpTo(_handle, &size, 0, len);
+        if (item == nullptr) {
+            return 0;
+        }
+        memcpy(dest, item, size);
+        vRingbufferReturnItem(_handle, item);
+        return size;
+    }
+
+private:
+    RingbufHandle_t _handle;
+};
+
+template <class RING>
+struct BenchContext {
+    RING ring;
+    SemaphoreHandle_t done;
+    std::size_t mismatches;
+};
+
+template <class RING>
+static void bench_producer(void *arg)
+{
+    BenchContext<RING> *ctx = static_cast<BenchContext<RING>*>(arg);
+    uint8_t chunk[bench_chunk];
+    std::size_t sent = 0;
+    while (sent < bench_total) {
+        for (std::size_t i = 0; i < bench_chunk; ++i) {
+            chunk[i] = (sent + i) & 0xFF;
+        }
+        std::size_t written = 0;
+        while (written < bench_chunk) {
+            const std::size_t len = ctx->ring.write(chunk + written, bench_chunk - written);
+            if (len == 0) {
+                taskYIELD();  // full: let the consumer run
+            }
+            written += len;
+        }
+        sent += bench_chunk;
+    }
+    xSemaphoreGive(ctx->done);
+    vTaskDelete(nullptr);
+}
+
+template <class RING>
+static void bench_consumer(void *arg)
+{
+    BenchContext<RING> *ctx = static_cast<BenchContext<RING>*>(arg);
+    uint8_t chunk[bench_chunk];
+    std::size_t received = 0;
+    while (received < bench_total) {
+        const std::size_t len = ctx->ring.read(chunk, bench_chunk);
+        if (len == 0) {
+            taskYIELD();  // empty: let the producer run
+        }
+        for (std::size_t i = 0; i < len; ++i) {
+            if (chunk[i] != ((received + i) & 0xFF)) {
+                ++ctx->mismatches;
+            }
+        }
+        received += len;
+    }
+    xSemaphoreGive(ctx->done);
+    vTaskDelete(nullptr);
+}
+
+/**
+ * @brief Move bench_total bytes through the ring from a producer task to a consumer task
+ *
+ * @return Throughput in MB/s
+ */
+template <class RING>
+static double bench_two_tasks(std::size_t *mismatches)
+{
+    BenchContext<RING> *ctx = new BenchContext<RING>();
+    ctx->done = xSemaphoreCreateCounting(2, 0);
+    ctx->mismatches = 0;
+
+    const auto start = std::chrono::steady_clock::now();
+    REQUIRE(xTaskCreate(bench_producer<RING>, "producer", 4096, ctx, 2, nullptr) == pdTRUE);
+    REQUIRE(xTaskCreate(bench_consumer<RING>, "consumer", 4096, ctx, 2, nullptr) == pdTRUE);
+    REQUIRE(xSemaphoreTake(ctx->done, pdMS_TO_TICKS(30000)) == pdTRUE);
+    REQUIRE(xSemaphoreTake(ctx->done, pdMS_TO_TICKS(30000)) == pdTRUE);
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    *mismatches = ctx->mismatches;
+    vSemaphoreDelete(ctx->done);
+    delete ctx;
+    return bench_total / seconds / 1e6;
+}
+
+/**
+ * @brief Write and read back one chunk at a time in the calling task: the cost of the calls themselves
+ *
+ * @return Time per write and read pair in ns
+ */
+template <class RING>
+static double bench_single_task()
+{
+    RING *ring = new RING();
+    uint8_t chunk[bench_chunk] = {};
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < bench_single_ops; ++i) {
+        ring->write(chunk, bench_chunk);
+        ring->read(chunk, bench_chunk);
+    }
+    const double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    delete ring;
+    return ns / bench_single_ops;
+}
+
+SCENARIO("SPSC ring compared with the FreeRTOS ringbuffer")
+{
+    GIVEN("A producer and a consumer task") {
+        SECTION("Both rings deliver the data in order") {
+            std::size_t spsc_mismatches = 0;
+            std::size_t freertos_mismatches = 0;
+            const double spsc = bench_two_tasks<SpscRing>(&spsc_mismatches);
+            const double freertos = bench_two_tasks<FreeRTOSRing>(&freertos_mismatches);
+            printf("Two tasks, %u byte chunks: SPSC ring %.1f MB/s, FreeRTOS ringbuffer %.1f MB/s\n",
+                   (unsigned)bench_chunk, spsc, freertos);
+            REQUIRE(spsc_mismatches == 0);
+            REQUIRE(freertos_mismatches == 0);
+        }
+    }
+
+    GIVEN("One task") {
+        SECTION("Cost of a write and read") {
+            const double spsc = bench_single_task<SpscRing>();
+            const double freertos = bench_single_task<FreeRTOSRing>();
+            printf("One task, %u byte write + read: SPSC ring %.0f ns, FreeRTOS ringbuffer %.0f ns\n",
+                   (unsigned)bench_chunk, spsc, freertos);
+        }
+    }
+}
+
+SCENARIO("SPSC ring wraps around")
+{
+    USBHostSerialRingbuf<16> ring;
+    uint8_t data[16];
+    for (uint8_t i = 0; i < sizeof(data); ++i) {
+        data[i] = i;
+    }
+
+    GIVEN("The indices are moved close to the end of the buffer") {
+        REQUIRE(ring.write(data, 12) == 12);
+        uint8_t out[16];
+        REQUIRE(ring.read(out, 12) == 12);
+
+        SECTION("A write is split over the end and the start") {
+            REQUIRE(ring.write(data, 10) == 10);
+            REQUIRE(ring.size() == 10);
+
+            const uint8_t *span = nullptr;
+            REQUIRE(ring.readSpan(&span) == 4);  // contiguous up to the end
+            REQUIRE(span[0] == 0);
+
+            REQUIRE(ring.read(out, sizeof(out)) == 10);
+            for (uint8_t i = 0; i < 10; ++i) {
+                REQUIRE(out[i] == i);
+            }
+        }
+
+        SECTION("Writes stop when the ring is full") {
+            REQUIRE(ring.write(data, 16) == 16);
+            REQUIRE(ring.write(data, 1) == 0);
+            REQUIRE(ring.space() == 0);
+        }
+    }
+}
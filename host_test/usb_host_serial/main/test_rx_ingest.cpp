@@ -0,0 +1,88 @@
+/*
+Copyright (c) 2024 Bert Melis. All rights reserved.
+
+This work is licensed under the terms of the MIT license.
+For a copy, see <https://opensource.org/licenses/MIT> or
+the LICENSE file.
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include <catch2/catch_test_macros.hpp>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/ringbuf.h"
+
+#include "test_serial.hpp"
+
+static constexpr int bench_transfers = 20000;
+
+/**
+ * @brief RX ingest as it was before: one ringbuffer send per byte, in a 10 ms blocking call
+ */
+static bool handle_rx_per_byte(RingbufHandle_t ring, const uint8_t *data, size_t data_len)
+{
+    for (size_t i = 0; i < data_len; ++i) {
+        if (xRingbufferSend(ring, &data[i], 1, pdMS_TO_TICKS(10)) != pdTRUE) {
+            return true; // overflow, rest of the transfer is lost
+        }
+    }
+    return true;
+}
+
+SCENARIO("RX ingest of a full USB transfer")
+{
+    uint8_t transfer[USBHOSTSERIAL_BUFFERSIZE];
+    for (size_t i = 0; i < sizeof(transfer); ++i) {
+        transfer[i] = i & 0xFF;
+    }
+    uint8_t out[USBHOSTSERIAL_BUFFERSIZE];
+
+    GIVEN("An empty RX buffer") {
+        TestSerial *serial = new TestSerial();
+
+        SECTION("The transfer is copied in one call") {
+            REQUIRE(TestSerial::_handle_rx(transfer, sizeof(transfer), serial));
+            REQUIRE(serial->available() == sizeof(transfer));
+            REQUIRE(serial->read(out, sizeof(out)) == sizeof(out));
+            REQUIRE(memcmp(out, transfer, sizeof(out)) == 0);
+            REQUIRE(serial->rxDropped() == 0);
+        }
+
+        SECTION("What doesn't fit is dropped and counted") {
+            REQUIRE(TestSerial::_handle_rx(transfer, sizeof(transfer), serial));
+            REQUIRE(TestSerial::_handle_rx(transfer, 10, serial));
+            REQUIRE(serial->available() == sizeof(transfer));
+            REQUIRE(serial->rxDropped() == 10);
+        }
+
+        SECTION("Cost per transfer, before and after") {
+            RingbufHandle_t ring = xRingbufferCreate(USBHOSTSERIAL_BUFFERSIZE, RINGBUF_TYPE_BYTEBUF);
+            REQUIRE(ring != nullptr);
+            auto start = std::chrono::steady_clock::now();
+            for (int i = 0; i < bench_transfers; ++i) {
+                handle_rx_per_byte(ring, transfer, sizeof(transfer));
+                size_t size = 0;
+                void *item = xRingbufferReceiveUpTo(ring, &size, 0, sizeof(out));
+                REQUIRE(size == sizeof(transfer));
+                vRingbufferReturnItem(ring, item);
+            }
+            const double before_us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / bench_transfers;
+            vRingbufferDelete(ring);
+
+            start = std::chrono::steady_clock::now();
+            for (int i = 0; i < bench_transfers; ++i) {
+                TestSerial::_handle_rx(transfer, sizeof(transfer), serial);
+                REQUIRE(serial->read(out, sizeof(out)) == sizeof(transfer));
+            }
+            const double after_us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / bench_transfers;
+
+            printf("RX ingest and read of a %u byte transfer: per byte ringbuffer sends %.2f us, bulk copy %.2f us (%.0f MB/s)\n",
+                   (unsigned)sizeof(transfer), before_us, after_us, sizeof(transfer) / after_us);
+            REQUIRE(serial->rxDropped() == 0);
+        }
+
+        delete serial;
+    }
+}
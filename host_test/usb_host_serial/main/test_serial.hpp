@@ -0,0 +1,22 @@
+/*
+Copyright (c) 2024 Bert Melis. All rights reserved.
+
+This work is licensed under the terms of the MIT license.
+For a copy, see <https://opensource.org/licenses/MIT> or
+the LICENSE file.
+*/
+
+#pragma once
+
+#include "USBHostSerial.h"
+
+/**
+ * @brief USBHostSerial with the driver callbacks and buffers exposed
+ *
+ * begin() is never called: no device is opened and there is no TX task, the tests play the USB side.
+ */
+class TestSerial : public USBHostSerial {
+public:
+    using USBHostSerial::_handle_rx;
+    using USBHostSerial::_tx_buf;
+};
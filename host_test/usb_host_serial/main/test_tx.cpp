@@ -0,0 +1,275 @@
+/*
+Copyright (c) 2024 Bert Melis. All rights reserved.
+
+This work is licensed under the terms of the MIT license.
+For a copy, see <https://opensource.org/licenses/MIT> or
+the LICENSE file.
+*/
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <catch2/catch_test_macros.hpp>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+
+#include "USBHostSerial.h"
+
+extern "C" {
+#include "Mockusb_host.h"
+}
+
+using clk = std::chrono::steady_clock;
+
+static constexpr uint16_t test_vid = 0x303A;
+static constexpr uint16_t test_pid = 0x4001;
+static constexpr uint8_t test_dev_addr = 1;
+
+// CDC-ACM device: communication interface 0 with notification EP 0x81, data interface 1 with EP 0x02 OUT and 0x82 IN
+static const uint8_t test_device_desc[] = {
+    0x12, 0x01, 0x00, 0x02, 0x02, 0x00, 0x00, 0x40, 0x3A, 0x30, 0x01, 0x40, 0x00, 0x01, 0x00, 0x00, 0x00, 0x01
+};
+static const uint8_t test_config_desc[] = {
+    0x09, 0x02, 0x43, 0x00, 0x02, 0x01, 0x00, 0x80, 0x32,
+    0x09, 0x04, 0x00, 0x00, 0x01, 0x02, 0x02, 0x00, 0x00,
+    0x05, 0x24, 0x00, 0x20, 0x01,                    // Header
+    0x05, 0x24, 0x01, 0x00, 0x01,                    // Call management
+    0x04, 0x24, 0x02, 0x02,                          // ACM
+    0x05, 0x24, 0x06, 0x00, 0x01,                    // Union
+    0x07, 0x05, 0x81, 0x03, 0x08, 0x00, 0x10,
+    0x09, 0x04, 0x01, 0x00, 0x02, 0x0A, 0x00, 0x00, 0x00,
+    0x07, 0x05, 0x02, 0x02, 0x40, 0x00, 0x00,
+    0x07, 0x05, 0x82, 0x02, 0x40, 0x00, 0x00,
+};
+
+/**
+ * @brief The mocked USB Host library: the event handlers block until they are unblocked, like the real ones
+ */
+static SemaphoreHandle_t lib_events;
+static SemaphoreHandle_t client_events;
+static int test_device;
+static int test_client;
+
+static esp_err_t _ok_mock_callback(int call_count)
+{
+    return ESP_OK;
+}
+static esp_err_t _install_mock_callback(const usb_host_config_t *config, int call_count)
+{
+    return ESP_OK;
+}
+static esp_err_t _lib_handle_events_mock_callback(TickType_t timeout_ticks, uint32_t *event_flags_ret, int call_count)
+{
+    xSemaphoreTake(lib_events, timeout_ticks);
+    *event_flags_ret = 0;
+    return ESP_OK;
+}
+static esp_err_t _lib_unblock_mock_callback(int call_count)
+{
+    xSemaphoreGive(lib_events);
+    return ESP_OK;
+}
+static esp_err_t _client_register_mock_callback(const usb_host_client_config_t *client_config, usb_host_client_handle_t *client_hdl_ret, int call_count)
+{
+    *client_hdl_ret = (usb_host_client_handle_t)&test_client;
+    return ESP_OK;
+}
+static esp_err_t _client_mock_callback(usb_host_client_handle_t client_hdl, int call_count)
+{
+    return ESP_OK;
+}
+static esp_err_t _client_handle_events_mock_callback(usb_host_client_handle_t client_hdl, TickType_t timeout_ticks, int call_count)
+{
+    xSemaphoreTake(client_events, timeout_ticks);
+    return ESP_OK;
+}
+static esp_err_t _client_unblock_mock_callback(usb_host_client_handle_t client_hdl, int call_count)
+{
+    xSemaphoreGive(client_events);
+    return ESP_OK;
+}
+
+/**
+ * @brief One connected device at test_dev_addr
+ */
+static esp_err_t _addr_list_fill_mock_callback(int list_len, uint8_t *dev_addr_list, int *num_dev_ret, int call_count)
+{
+    dev_addr_list[0] = test_dev_addr;
+    *num_dev_ret = 1;
+    return ESP_OK;
+}
+static esp_err_t _device_open_mock_callback(usb_host_client_handle_t client_hdl, uint8_t dev_addr, usb_device_handle_t *dev_hdl_ret, int call_count)
+{
+    *dev_hdl_ret = (usb_device_handle_t)&test_device;
+    return dev_addr == test_dev_addr ? ESP_OK : ESP_ERR_NOT_FOUND;
+}
+static esp_err_t _device_close_mock_callback(usb_host_client_handle_t client_hdl, usb_device_handle_t dev_hdl, int call_count)
+{
+    return ESP_OK;
+}
+static esp_err_t _device_info_mock_callback(usb_device_handle_t dev_hdl, usb_device_info_t *dev_info, int call_count)
+{
+    memset(dev_info, 0, sizeof(usb_device_info_t));
+    dev_info->dev_addr = test_dev_addr;
+    dev_info->bMaxPacketSize0 = 64;
+    dev_info->bConfigurationValue = 1;
+    return ESP_OK;
+}
+static esp_err_t _device_desc_mock_callback(usb_device_handle_t dev_hdl, const usb_device_desc_t **device_desc, int call_count)
+{
+    *device_desc = (const usb_device_desc_t *)test_device_desc;
+    return ESP_OK;
+}
+static esp_err_t _config_desc_mock_callback(usb_device_handle_t dev_hdl, const usb_config_desc_t **config_desc, int call_count)
+{
+    *config_desc = (const usb_config_desc_t *)test_config_desc;
+    return ESP_OK;
+}
+static esp_err_t _interface_claim_mock_callback(usb_host_client_handle_t client_hdl, usb_device_handle_t dev_hdl, uint8_t bInterfaceNumber, uint8_t bAlternateSetting, int call_count)
+{
+    return ESP_OK;
+}
+static esp_err_t _interface_release_mock_callback(usb_host_client_handle_t client_hdl, usb_device_handle_t dev_hdl, uint8_t bInterfaceNumber, int call_count)
+{
+    return ESP_OK;
+}
+static esp_err_t _endpoint_mock_callback(usb_device_handle_t dev_hdl, uint8_t bEndpointAddress, int call_count)
+{
+    return ESP_OK;
+}
+static esp_err_t _transfer_alloc_mock_callback(size_t data_buffer_size, int num_isoc_packets, usb_transfer_t **transfer, int call_count)
+{
+    usb_transfer_t *xfer = (usb_transfer_t *)calloc(1, sizeof(usb_transfer_t));
+    uint8_t *data_buffer = (uint8_t *)calloc(1, data_buffer_size);
+    usb_transfer_t init = {
+        .data_buffer = data_buffer,
+        .data_buffer_size = data_buffer_size,
+    };
+    memcpy(xfer, &init, sizeof(usb_transfer_t));
+    *transfer = xfer;
+    return ESP_OK;
+}
+static esp_err_t _transfer_free_mock_callback(usb_transfer_t *transfer, int call_count)
+{
+    if (transfer) {
+        free(transfer->data_buffer);
+        free(transfer);
+    }
+    return ESP_OK;
+}
+
+/**
+ * @brief The device accepts every control request right away
+ */
+static esp_err_t _ctrl_submit_mock_callback(usb_host_client_handle_t client_hdl, usb_transfer_t *transfer, int call_count)
+{
+    transfer->status = USB_TRANSFER_STATUS_COMPLETED;
+    transfer->actual_num_bytes = transfer->num_bytes;
+    transfer->callback(transfer);
+    return ESP_OK;
+}
+
+/**
+ * @brief IN transfers stay pending, OUT transfers are recorded and completed right away
+ */
+static std::atomic<int> out_submits;
+static std::atomic<int64_t> out_submit_ns;  // time of the last OUT submit
+static SemaphoreHandle_t out_submitted;
+static esp_err_t _transfer_submit_mock_callback(usb_transfer_t *transfer, int call_count)
+{
+    if (transfer->bEndpointAddress & 0x80) {
+        return ESP_OK;
+    }
+    out_submit_ns.store(std::chrono::duration_cast<std::chrono::nanoseconds>(clk::now().time_since_epoch()).count());
+    out_submits.fetch_add(1);
+    transfer->status = USB_TRANSFER_STATUS_COMPLETED;
+    transfer->actual_num_bytes = transfer->num_bytes;
+    transfer->callback(transfer);
+    xSemaphoreGive(out_submitted);
+    return ESP_OK;
+}
+
+static void _mock_usb_host(bool on)
+{
+    usb_host_install_Stub(on ? _install_mock_callback : nullptr);
+    usb_host_uninstall_Stub(on ? _ok_mock_callback : nullptr);
+    usb_host_lib_handle_events_Stub(on ? _lib_handle_events_mock_callback : nullptr);
+    usb_host_lib_unblock_Stub(on ? _lib_unblock_mock_callback : nullptr);
+    usb_host_device_free_all_Stub(on ? _ok_mock_callback : nullptr);
+    usb_host_client_register_Stub(on ? _client_register_mock_callback : nullptr);
+    usb_host_client_deregister_Stub(on ? _client_mock_callback : nullptr);
+    usb_host_client_handle_events_Stub(on ? _client_handle_events_mock_callback : nullptr);
+    usb_host_client_unblock_Stub(on ? _client_unblock_mock_callback : nullptr);
+    usb_host_device_addr_list_fill_Stub(on ? _addr_list_fill_mock_callback : nullptr);
+    usb_host_device_open_Stub(on ? _device_open_mock_callback : nullptr);
+    usb_host_device_close_Stub(on ? _device_close_mock_callback : nullptr);
+    usb_host_device_info_Stub(on ? _device_info_mock_callback : nullptr);
+    usb_host_get_device_descriptor_Stub(on ? _device_desc_mock_callback : nullptr);
+    usb_host_get_active_config_descriptor_Stub(on ? _config_desc_mock_callback : nullptr);
+    usb_host_interface_claim_Stub(on ? _interface_claim_mock_callback : nullptr);
+    usb_host_interface_release_Stub(on ? _interface_release_mock_callback : nullptr);
+    usb_host_endpoint_halt_Stub(on ? _endpoint_mock_callback : nullptr);
+    usb_host_endpoint_flush_Stub(on ? _endpoint_mock_callback : nullptr);
+    usb_host_endpoint_clear_Stub(on ? _endpoint_mock_callback : nullptr);
+    usb_host_transfer_alloc_Stub(on ? _transfer_alloc_mock_callback : nullptr);
+    usb_host_transfer_free_Stub(on ? _transfer_free_mock_callback : nullptr);
+    usb_host_transfer_submit_Stub(on ? _transfer_submit_mock_callback : nullptr);
+    usb_host_transfer_submit_control_Stub(on ? _ctrl_submit_mock_callback : nullptr);
+}
+
+SCENARIO("The TX task is woken by write()")
+{
+    GIVEN("A mocked CDC-ACM device opened by the TX task") {
+        lib_events = xSemaphoreCreateBinary();
+        client_events = xSemaphoreCreateBinary();
+        out_submitted = xSemaphoreCreateBinary();
+        out_submits = 0;
+        _mock_usb_host(true);
+
+        USBHostSerial *serial = new USBHostSerial(test_vid, test_pid);
+        REQUIRE(serial->begin(115200, 0, 0, 8));
+        const TickType_t opened_by = xTaskGetTickCount() + pdMS_TO_TICKS(1000);
+        while (!*serial && xTaskGetTickCount() < opened_by) {
+            vTaskDelay(1);
+        }
+        REQUIRE(static_cast<bool>(*serial));
+
+        SECTION("Data is submitted well within a millisecond of write()") {
+            const uint8_t msg[8] = {'l', 'a', 't', 'e', 'n', 'c', 'y', '\n'};
+            std::vector<double> latency_us;
+            for (int i = 0; i < 100; ++i) {
+                const auto start = clk::now();
+                REQUIRE(serial->write(msg, sizeof(msg)) == sizeof(msg));
+                REQUIRE(xSemaphoreTake(out_submitted, pdMS_TO_TICKS(100)) == pdTRUE);
+                const int64_t start_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(start.time_since_epoch()).count();
+                latency_us.push_back((out_submit_ns.load() - start_ns) / 1000.0);
+            }
+            std::sort(latency_us.begin(), latency_us.end());
+            const double median = latency_us[latency_us.size() / 2];
+            printf("write() to BULK OUT submit: median %.1f us, max %.1f us\n", median, latency_us.back());
+            REQUIRE(median < 1000);
+        }
+
+        SECTION("Nothing is submitted while the TX buffer is empty") {
+            const uint8_t msg[4] = {'i', 'd', 'l', 'e'};
+            REQUIRE(serial->write(msg, sizeof(msg)) == sizeof(msg));
+            REQUIRE(xSemaphoreTake(out_submitted, pdMS_TO_TICKS(100)) == pdTRUE);
+            const int submits = out_submits.load();
+            vTaskDelay(pdMS_TO_TICKS(100));
+            REQUIRE(out_submits.load() == submits);
+        }
+
+        serial->end();
+        delete serial;
+        _mock_usb_host(false);
+        vSemaphoreDelete(out_submitted);
+        vSemaphoreDelete(client_events);
+        vSemaphoreDelete(lib_events);
+    }
+}
@@ -0,0 +1,103 @@
+/*
+Copyright (c) 2024 Bert Melis. All rights reserved.
+
+This work is licensed under the terms of the MIT license.
+For a copy, see <https://opensource.org/licenses/MIT> or
+the LICENSE file.
+*/
+
+#include <chrono>
+#include <catch2/catch_test_macros.hpp>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+
+#include "test_serial.hpp"
+
+/**
+ * @brief Transfers handed to _handle_rx by a feeder task, the way the CDC-ACM driver task does
+ */
+struct RxFeeder {
+    TestSerial *serial;
+    std::size_t len;       // bytes per transfer
+    int transfers;
+    uint32_t delay_ms;     // before each transfer
+    SemaphoreHandle_t done;
+};
+
+static void rx_feeder_task(void *arg)
+{
+    RxFeeder *feeder = static_cast<RxFeeder*>(arg);
+    uint8_t data[USBHOSTSERIAL_BUFFERSIZE] = {};
+    for (int i = 0; i < feeder->transfers; ++i) {
+        vTaskDelay(pdMS_TO_TICKS(feeder->delay_ms));
+        TestSerial::_handle_rx(data, feeder->len, feeder->serial);
+    }
+    xSemaphoreGive(feeder->done);
+    vTaskDelete(nullptr);
+}
+
+/**
+ * @brief Start the feeder, wait in the calling task and feed the elapsed time back
+ *
+ * @return Return value of waitForData
+ */
+static std::size_t wait_for_feeder(RxFeeder *feeder, std::size_t minBytes, uint32_t timeout, double *elapsed_ms)
+{
+    feeder->done = xSemaphoreCreateBinary();
+    REQUIRE(xTaskCreate(rx_feeder_task, "rx_feeder", 4096, feeder, 5, nullptr) == pdTRUE);
+    const auto start = std::chrono::steady_clock::now();
+    const std::size_t avail = feeder->serial->waitForData(minBytes, timeout);
+    *elapsed_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    REQUIRE(xSemaphoreTake(feeder->done, pdMS_TO_TICKS(1000)) == pdTRUE);
+    vSemaphoreDelete(feeder->done);
+    return avail;
+}
+
+SCENARIO("waitForData wakes on received data")
+{
+    GIVEN("A reader waiting for data") {
+        TestSerial *serial = new TestSerial();
+        RxFeeder feeder = {serial, 0, 1, 20, nullptr};
+        double elapsed = 0;
+
+        SECTION("It wakes when enough data arrived, long before the timeout") {
+            feeder.len = 16;
+            REQUIRE(wait_for_feeder(&feeder, 16, 1000, &elapsed) == 16);
+            REQUIRE(elapsed >= 15);
+            REQUIRE(elapsed < 100);
+        }
+
+        SECTION("Less data is returned once nothing arrives for the idle gap") {
+            feeder.len = 8;
+            REQUIRE(wait_for_feeder(&feeder, 64, 1000, &elapsed) == 8);
+            REQUIRE(elapsed >= 15);
+            REQUIRE(elapsed < 100);
+        }
+
+        SECTION("Data arriving within the idle gap keeps it waiting") {
+            serial->setRxIdleGap(50);
+            feeder.len = 8;
+            feeder.transfers = 3;
+            REQUIRE(wait_for_feeder(&feeder, 24, 1000, &elapsed) == 24);
+            REQUIRE(elapsed >= 50);
+            REQUIRE(elapsed < 200);
+        }
+
+        SECTION("Without idle gap it waits for the timeout") {
+            serial->setRxIdleGap(0);
+            feeder.len = 8;
+            REQUIRE(wait_for_feeder(&feeder, 64, 100, &elapsed) == 8);
+            REQUIRE(elapsed >= 90);
+        }
+
+        SECTION("Without data it times out") {
+            feeder.transfers = 0;
+            REQUIRE(wait_for_feeder(&feeder, 1, 50, &elapsed) == 0);
+            REQUIRE(elapsed >= 40);
+        }
+
+        delete serial;
+    }
+}
@@ -0,0 +1,58 @@
+/*
+Copyright (c) 2024 Bert Melis. All rights reserved.
+
+This work is licensed under the terms of the MIT license.
+For a copy, see <https://opensource.org/licenses/MIT> or
+the LICENSE file.
+*/
+
+#include <string.h>
+#include <catch2/catch_test_macros.hpp>
+
+#include "test_serial.hpp"
+
+SCENARIO("Zero-copy write")
+{
+    TestSerial *serial = new TestSerial();
+    uint8_t data[USBHOSTSERIAL_BUFFERSIZE];
+    for (size_t i = 0; i < sizeof(data); ++i) {
+        data[i] = i & 0xFF;
+    }
+
+    GIVEN("Free space that wraps around the end of the TX buffer") {
+        // fill and send all but the last 8 bytes: 8 bytes are free at the end, the rest at the start
+        REQUIRE(serial->write(data, USBHOSTSERIAL_BUFFERSIZE - 8) == USBHOSTSERIAL_BUFFERSIZE - 8);
+        uint8_t sent[USBHOSTSERIAL_BUFFERSIZE];
+        REQUIRE(serial->_tx_buf.read(sent, sizeof(sent)) == USBHOSTSERIAL_BUFFERSIZE - 8);
+        REQUIRE(serial->_tx_buf.space() == USBHOSTSERIAL_BUFFERSIZE);
+
+        SECTION("Only the lent block is committed") {
+            uint8_t *block = nullptr;
+            REQUIRE(serial->beginWrite(&block) == 8);
+            memset(block, 0xAA, 8);
+            serial->commitWrite(20);  // more than lent, less than free
+            REQUIRE(serial->_tx_buf.size() == 8);
+
+            // the next block starts at the beginning of the buffer
+            REQUIRE(serial->beginWrite(&block) == USBHOSTSERIAL_BUFFERSIZE - 8);
+            memset(block, 0x55, 4);
+            serial->commitWrite(4);
+            REQUIRE(serial->_tx_buf.size() == 12);
+
+            REQUIRE(serial->_tx_buf.read(sent, sizeof(sent)) == 12);
+            for (size_t i = 0; i < 8; ++i) {
+                REQUIRE(sent[i] == 0xAA);
+            }
+            for (size_t i = 8; i < 12; ++i) {
+                REQUIRE(sent[i] == 0x55);
+            }
+        }
+
+        SECTION("A commit without beginWrite sends nothing") {
+            serial->commitWrite(4);
+            REQUIRE(serial->_tx_buf.size() == 0);
+        }
+    }
+
+    delete serial;
+}
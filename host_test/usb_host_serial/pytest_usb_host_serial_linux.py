@@ -0,0 +1,10 @@
+# SPDX-License-Identifier: Unlicense OR CC0-1.0
+import pytest
+from pytest_embedded import Dut
+from pytest_embedded_idf.utils import idf_parametrize
+
+
+@pytest.mark.host_test
+@idf_parametrize('target', ['linux'], indirect=['target'])
+def test_usb_host_serial_linux(dut: Dut) -> None:
+    dut.expect_exact('All tests passed', timeout=60)
@@ -29,6 +29,16 @@ static const char *TAG = "cdc_acm";
 #define CDC_ACM_CTRL_TRANSFER_SIZE (64)   // All standard CTRL requests and responses fit in this size
 #define CDC_ACM_CTRL_TIMEOUT_MS    (5000) // Every CDC device should be able to respond to CTRL transfer in 5 seconds
 
+// Line state cache constants
+#define CDC_ACM_LINE_CACHE_SIZE (8) // Closed interfaces whose line state is remembered for the next open
+
+// Data OUT constants
+#define CDC_ACM_TX_FLUSH_TIMEOUT_MS (100) // Wait for the completions of flushed OUT transfers after a blocking transmit timed out
+
+// Data IN pipe recovery constants
+#define CDC_ACM_IN_RECOVERY_RETRIES    (5) // Recovery attempts before IN polling is given up, reset when data is received
+#define CDC_ACM_IN_RECOVERY_BACKOFF_MS (2) // Delay before the second attempt, doubled for every next attempt. The first attempt is immediate
+
 // CDC-ACM spinlock
 static portMUX_TYPE cdc_acm_lock = portMUX_INITIALIZER_UNLOCKED;
 #define CDC_ACM_ENTER_CRITICAL()   portENTER_CRITICAL(&cdc_acm_lock)
@@ -38,17 +48,128 @@ static portMUX_TYPE cdc_acm_lock = portMUX_INITIALIZER_UNLOCKED;
 #define CDC_ACM_TEARDOWN          BIT0
 #define CDC_ACM_TEARDOWN_COMPLETE BIT1
 
+// Bit of an interface index in cdc_acm_addr_entry_t::intf_mask. Only the first 32 interfaces are tracked
+#define CDC_ACM_INTF_BIT(interface_idx) (((interface_idx) < 32) ? (1UL << (interface_idx)) : 0)
+
+// USB device opened by this driver, entry of the table indexed by device address
+typedef struct {
+    usb_device_handle_t dev_hdl;  /*!< Shared by all CDC devices on this USB device, NULL if none is open */
+    uint16_t vid;                 /*!< Cached from the device descriptor */
+    uint16_t pid;                 /*!< Cached from the device descriptor */
+    uint32_t intf_mask;           /*!< Interfaces that are open or being opened, by interface_idx */
+} cdc_acm_addr_entry_t;
+
+// Line state of a closed interface, a reopen while the device stays connected starts from it
+typedef struct {
+    uint8_t dev_addr;             /*!< USB device address, 0 if the entry is unused */
+    uint8_t intf_num;             /*!< bInterfaceNumber of the data interface */
+    cdc_line_state_t line_state;
+} cdc_acm_line_cache_t;
+
 // CDC-ACM driver object
 typedef struct {
     usb_host_client_handle_t cdc_acm_client_hdl;        /*!< USB Host handle reused for all CDC-ACM devices in the system */
-    SemaphoreHandle_t open_close_mutex;
+    SemaphoreHandle_t open_close_mutex;                 /*!< Serializes uninstall, open and close only count themselves in open_close_cnt */
+    int open_close_cnt;                                 /*!< Number of open and close calls in progress */
+    cdc_acm_addr_entry_t open_devs[CDC_HOST_MAX_DEVICES + 1]; /*!< Open USB devices, indexed by device address */
     EventGroupHandle_t event_group;
     cdc_acm_new_dev_callback_t new_dev_cb;
+    bool in_drain_pending;                              /*!< A device was resumed with held IN transfers */
+    uint8_t in_recovery_cnt;                            /*!< Number of devices waiting for an IN pipe recovery attempt */
+    TaskHandle_t driver_task_h;                         /*!< Client task, the only one that walks cdc_devices_list outside the lock */
+    bool list_walking;                                  /*!< The client task is walking cdc_devices_list: removed devices are not freed yet */
+    cdc_acm_line_cache_t line_cache[CDC_ACM_LINE_CACHE_SIZE]; /*!< Line state of closed interfaces, protected by the lock */
+    uint8_t line_cache_next;                            /*!< Entry replaced next when the cache is full */
     SLIST_HEAD(list_dev, cdc_dev_s) cdc_devices_list;   /*!< List of open pseudo devices */
 } cdc_acm_obj_t;
 
 static cdc_acm_obj_t *p_cdc_acm_obj = NULL;
 
+/**
+ * @brief Remember the line state of an interface that is being closed
+ *
+ * Must be called from a critical section.
+ *
+ * @param[in] cdc_dev Device being closed
+ */
+static void cdc_acm_line_cache_save(const cdc_dev_t *cdc_dev)
+{
+    cdc_acm_line_cache_t *free_entry = NULL;
+    const uint8_t intf_num = cdc_dev->data.intf_desc->bInterfaceNumber;
+    for (int i = 0; i < CDC_ACM_LINE_CACHE_SIZE; i++) {
+        cdc_acm_line_cache_t *entry = &p_cdc_acm_obj->line_cache[i];
+        if (entry->dev_addr == cdc_dev->dev_addr && entry->intf_num == intf_num) {
+            free_entry = entry;
+            break;
+        }
+        if (entry->dev_addr == 0 && free_entry == NULL) {
+            free_entry = entry;
+        }
+    }
+    if (free_entry == NULL) {
+        free_entry = &p_cdc_acm_obj->line_cache[p_cdc_acm_obj->line_cache_next];
+        p_cdc_acm_obj->line_cache_next = (p_cdc_acm_obj->line_cache_next + 1) % CDC_ACM_LINE_CACHE_SIZE;
+    }
+    free_entry->dev_addr = cdc_dev->dev_addr;
+    free_entry->intf_num = intf_num;
+    free_entry->line_state = cdc_dev->line_state;
+}
+
+/**
+ * @brief Start an opened interface from the line state it was left in, if it is remembered
+ *
+ * Must be called from a critical section.
+ *
+ * @param[inout] cdc_dev Device being opened
+ */
+static void cdc_acm_line_cache_take(cdc_dev_t *cdc_dev)
+{
+    const uint8_t intf_num = cdc_dev->data.intf_desc->bInterfaceNumber;
+    for (int i = 0; i < CDC_ACM_LINE_CACHE_SIZE; i++) {
+        cdc_acm_line_cache_t *entry = &p_cdc_acm_obj->line_cache[i];
+        if (entry->dev_addr == cdc_dev->dev_addr && entry->intf_num == intf_num) {
+            cdc_dev->line_state = entry->line_state;
+            entry->dev_addr = 0;
+            break;
+        }
+    }
+}
+
+/**
+ * @brief Forget the line states remembered for a device address
+ *
+ * A device that connects, or disconnects, was reset: its state is unknown.
+ * Must be called from a critical section.
+ *
+ * @param[in] dev_addr USB device address
+ */
+static void cdc_acm_line_cache_forget(uint8_t dev_addr)
+{
+    for (int i = 0; i < CDC_ACM_LINE_CACHE_SIZE; i++) {
+        if (p_cdc_acm_obj->line_cache[i].dev_addr == dev_addr) {
+            p_cdc_acm_obj->line_cache[i].dev_addr = 0;
+        }
+    }
+}
+
+// Data IN pipe recovery states
+typedef enum {
+    CDC_IN_RECOVERY_IDLE = 0, // IN transfers are polling the endpoint
+    CDC_IN_RECOVERY_FLUSHING, // Endpoint was halted and flushed, waiting for the other IN transfers to return
+    CDC_IN_RECOVERY_BACKOFF,  // Waiting for the next attempt
+    CDC_IN_RECOVERY_CLEARING, // CLEAR_FEATURE(ENDPOINT_HALT) request is in flight
+    CDC_IN_RECOVERY_STOPPED,  // Out of retries or device is closing, IN transfers are not submitted anymore
+} cdc_in_recovery_state_t;
+
+// OUT data transfer of the pool
+struct cdc_out_slot_s {
+    usb_transfer_t *xfer;           // Bulk OUT transfer, its context points back to this slot
+    cdc_dev_t *cdc_dev;             // Owner of this slot
+    bool busy;                      // Transfer is in flight
+    cdc_acm_tx_callback_t done_cb;  // Called when the transfer completes
+    void *done_arg;                 // Argument for done_cb
+};
+
 /**
  * @brief Default CDC-ACM driver configuration
  *
@@ -80,14 +201,30 @@ static void notif_xfer_cb(usb_transfer_t *transfer);
 static void in_xfer_cb(usb_transfer_t *transfer);
 
 /**
- * @brief Data send callback
+ * @brief CLEAR_FEATURE(ENDPOINT_HALT) completed callback
  *
- * Reused for bulk OUT and CTRL transfers
+ * Restarts polling of the data IN endpoint, or schedules the next recovery attempt.
+ *
+ * @param[in] transfer Transfer that triggered the callback
+ */
+static void in_recovery_ctrl_cb(usb_transfer_t *transfer);
+
+/**
+ * @brief Control transfer completed callback
  *
  * @param[in] transfer Transfer that triggered the callback
  */
 static void out_xfer_cb(usb_transfer_t *transfer);
 
+/**
+ * @brief Data send callback
+ *
+ * Returns the bulk OUT transfer to the pool and reports the result to the submitter
+ *
+ * @param[in] transfer Transfer that triggered the callback
+ */
+static void out_data_xfer_cb(usb_transfer_t *transfer);
+
 /**
  * @brief USB Host Client event callback
  *
@@ -103,20 +240,59 @@ static void usb_event_cb(const usb_host_client_event_msg_t *event_msg, void *arg
  *
  * In in_xfer_cb() we can modify IN transfer parameters, this function resets the transfer to its defaults
  *
- * @param[in] cdc_dev Pointer to CDC device
+ * @param[in] cdc_dev  Pointer to CDC device
+ * @param[in] transfer IN transfer to reset
  */
-static void cdc_acm_reset_in_transfer(cdc_dev_t *cdc_dev)
+static void cdc_acm_reset_in_transfer(cdc_dev_t *cdc_dev, usb_transfer_t *transfer)
 {
-    assert(cdc_dev->data.in_xfer);
-    usb_transfer_t *transfer = cdc_dev->data.in_xfer;
-    uint8_t **ptr = (uint8_t **)(&(transfer->data_buffer));
-    *ptr = cdc_dev->data.in_data_buffer_base;
+    assert(transfer);
+    if (cdc_dev->data.in_xfer_cnt == 1) {
+        // Only a single IN transfer can have its buffer moved by appending data
+        uint8_t **ptr = (uint8_t **)(&(transfer->data_buffer));
+        *ptr = cdc_dev->data.in_data_buffer_base;
+    }
     transfer->num_bytes = transfer->data_buffer_size;
     // This is a hotfix for IDF changes, where 'transfer->data_buffer_size' does not contain actual buffer length,
     // but *allocated* buffer length, which can be larger if CONFIG_HEAP_POISONING_COMPREHENSIVE is enabled
     transfer->num_bytes -= transfer->data_buffer_size % cdc_dev->data.in_mps;
 }
 
+/**
+ * @brief Pass IN transfers held back while paused to the user, in completion order
+ *
+ * Runs in the CDC-ACM driver task, like in_xfer_cb(), so the user sees all data from one task.
+ * Stops early if the data callback pauses RX again.
+ *
+ * @param[in] cdc_dev Pointer to CDC device
+ */
+static void cdc_acm_in_xfers_drain(cdc_dev_t *cdc_dev);
+
+/**
+ * @brief Run IN pipe recovery attempts that are due
+ *
+ * Runs in the CDC-ACM driver task.
+ *
+ * @param[in] cdc_acm_obj Driver object
+ * @return Ticks until the next recovery attempt, portMAX_DELAY if none is scheduled
+ */
+static TickType_t cdc_acm_in_recovery_run(cdc_acm_obj_t *cdc_acm_obj);
+
+/**
+ * @brief Start or end a walk of the client task over cdc_devices_list outside the lock
+ *
+ * The callbacks called during the walk may block or close devices, so the lock can't be held.
+ * cdc_acm_host_close() takes a device out of the list right away but doesn't free it until the walk ended.
+ *
+ * @param[in] cdc_acm_obj Driver object
+ * @param[in] walking     true at the start of the walk, false at its end
+ */
+static void cdc_acm_list_walk(cdc_acm_obj_t *cdc_acm_obj, bool walking)
+{
+    CDC_ACM_ENTER_CRITICAL();
+    cdc_acm_obj->list_walking = walking;
+    CDC_ACM_EXIT_CRITICAL();
+}
+
 /**
  * @brief CDC-ACM driver handling task
  *
@@ -131,12 +307,31 @@ static void cdc_acm_client_task(void *arg)
     assert(cdc_acm_obj->cdc_acm_client_hdl);
 
     // Start handling client's events
+    TickType_t timeout = portMAX_DELAY;
     while (1) {
-        usb_host_client_handle_events(cdc_acm_obj->cdc_acm_client_hdl, portMAX_DELAY);
+        usb_host_client_handle_events(cdc_acm_obj->cdc_acm_client_hdl, timeout);
         EventBits_t events = xEventGroupGetBits(cdc_acm_obj->event_group);
         if (events & CDC_ACM_TEARDOWN) {
             break;
         }
+
+        // Deliver IN data of resumed devices
+        CDC_ACM_ENTER_CRITICAL();
+        const bool drain = cdc_acm_obj->in_drain_pending;
+        cdc_acm_obj->in_drain_pending = false;
+        CDC_ACM_EXIT_CRITICAL();
+        if (drain) {
+            cdc_dev_t *cdc_dev;
+            cdc_dev_t *tcdc_dev;
+            cdc_acm_list_walk(cdc_acm_obj, true);
+            SLIST_FOREACH_SAFE(cdc_dev, &cdc_acm_obj->cdc_devices_list, list_entry, tcdc_dev) {
+                cdc_acm_in_xfers_drain(cdc_dev);
+            }
+            cdc_acm_list_walk(cdc_acm_obj, false);
+        }
+
+        // Run IN pipe recovery attempts that are due, wake up in time for the next one
+        timeout = cdc_acm_in_recovery_run(cdc_acm_obj);
     }
 
     ESP_LOGD(TAG, "Deregistering client");
@@ -195,9 +390,9 @@ static esp_err_t cdc_acm_start(cdc_dev_t *cdc_dev, cdc_acm_host_dev_callback_t e
             cdc_dev->data.intf_desc->bInterfaceNumber,
             cdc_dev->data.intf_desc->bAlternateSetting),
         err, TAG, "Could not claim interface");
-    if (cdc_dev->data.in_xfer) {
+    for (int i = 0; i < cdc_dev->data.in_xfer_cnt; i++) {
         ESP_LOGD(TAG, "Submitting poll for BULK IN transfer");
-        ESP_ERROR_CHECK(usb_host_transfer_submit(cdc_dev->data.in_xfer));
+        ESP_ERROR_CHECK(usb_host_transfer_submit(cdc_dev->data.in_xfers[i]));
     }
 
     // If notification are supported, claim its interface and start polling its IN endpoint
@@ -243,26 +438,88 @@ static void cdc_acm_device_remove(cdc_dev_t *cdc_dev)
     assert(cdc_dev);
     cdc_acm_transfers_free(cdc_dev);
     free(cdc_dev->cdc_func_desc);
+    free(cdc_dev->intf_ctx);
+
+    // Release the interface in the table of open devices
+    CDC_ACM_ENTER_CRITICAL();
+    cdc_acm_addr_entry_t *entry = &p_cdc_acm_obj->open_devs[cdc_dev->dev_addr];
+    entry->intf_mask &= ~cdc_dev->intf_bit;
+    if (entry->intf_mask == 0 && entry->dev_hdl == cdc_dev->dev_hdl) {
+        entry->dev_hdl = NULL;
+    }
+    CDC_ACM_EXIT_CRITICAL();
+
     // We don't check the error code of usb_host_device_close, as the close might fail, if someone else is still using the device (not all interfaces are released)
     usb_host_device_close(p_cdc_acm_obj->cdc_acm_client_hdl, cdc_dev->dev_hdl); // Gracefully continue on error
     free(cdc_dev);
 }
 
+/**
+ * @brief Reserve an interface of an already opened USB device with requested VID/PID
+ *
+ * @param[in] vid       Vendor ID
+ * @param[in] pid       Product ID
+ * @param[in] intf_bit  Interface to reserve, see CDC_ACM_INTF_BIT()
+ * @param[in] sibling   Only consider the USB device of this CDC device, NULL for any
+ * @param[inout] dev    CDC-ACM device, its USB device handle and address are set on success
+ * @return true if the interface was reserved
+ */
+static bool cdc_acm_open_devs_reserve(uint16_t vid, uint16_t pid, uint32_t intf_bit, const cdc_dev_t *sibling, cdc_dev_t *dev)
+{
+    bool reserved = false;
+    int first_addr = 1;
+    int last_addr = CDC_HOST_MAX_DEVICES;
+    CDC_ACM_ENTER_CRITICAL();
+    if (sibling) {
+        // The sibling handle is only trusted while it is in the devices list
+        cdc_dev_t *cdc_dev;
+        last_addr = 0;
+        SLIST_FOREACH(cdc_dev, &p_cdc_acm_obj->cdc_devices_list, list_entry) {
+            if (cdc_dev == sibling) {
+                first_addr = last_addr = sibling->dev_addr;
+                break;
+            }
+        }
+    }
+    for (int addr = first_addr; addr <= last_addr; addr++) {
+        cdc_acm_addr_entry_t *entry = &p_cdc_acm_obj->open_devs[addr];
+        if (entry->dev_hdl != NULL &&
+                (vid == entry->vid || vid == CDC_HOST_ANY_VID) &&
+                (pid == entry->pid || pid == CDC_HOST_ANY_PID) &&
+                !(entry->intf_mask & intf_bit)) {
+            entry->intf_mask |= intf_bit;
+            dev->dev_hdl = entry->dev_hdl;
+            dev->dev_addr = addr;
+            dev->intf_bit = intf_bit;
+            reserved = true;
+            break;
+        }
+    }
+    CDC_ACM_EXIT_CRITICAL();
+    return reserved;
+}
+
 /**
  * @brief Open USB device with requested VID/PID
  *
  * This function has two regular return paths:
- * 1. USB device with matching VID/PID is already opened by this driver: allocate new CDC device on top of the already opened USB device.
+ * 1. USB device with matching VID/PID is already opened by this driver and the interface is free: allocate new CDC device on top of the already opened USB device.
  * 2. USB device with matching VID/PID is NOT opened by this driver yet: poll USB connected devices until it is found.
  *
+ * Opened USB devices are kept in a table indexed by device address, with their VID/PID and the interfaces in use.
+ * The interface is reserved in this table, so opens of other devices or other interfaces don't wait for each other.
+ * With a sibling, only return path 1 is taken, on the sibling's USB device.
+ *
  * @note This function will block for timeout_ms, if the device is not enumerated at the moment of calling this function.
  * @param[in] vid Vendor ID
  * @param[in] pid Product ID
+ * @param[in] interface_idx Index of the interface that will be opened
  * @param[in] timeout_ms Connection timeout [ms]
+ * @param[in] sibling Open CDC device whose USB device must be used, NULL for any
  * @param[out] dev CDC-ACM device
  * @return esp_err_t
  */
-static esp_err_t cdc_acm_find_and_open_usb_device(uint16_t vid, uint16_t pid, int timeout_ms, cdc_dev_t **dev)
+static esp_err_t cdc_acm_find_and_open_usb_device(uint16_t vid, uint16_t pid, uint8_t interface_idx, int timeout_ms, const cdc_dev_t *sibling, cdc_dev_t **dev)
 {
     assert(p_cdc_acm_obj);
     assert(dev);
@@ -271,19 +528,19 @@ static esp_err_t cdc_acm_find_and_open_usb_device(uint16_t vid, uint16_t pid, in
     if (*dev == NULL) {
         return ESP_ERR_NO_MEM;
     }
+    const uint32_t intf_bit = CDC_ACM_INTF_BIT(interface_idx);
 
-    // First, check list of already opened CDC devices
+    // First, check table of already opened USB devices
     ESP_LOGD(TAG, "Checking list of opened USB devices");
-    cdc_dev_t *cdc_dev;
-    SLIST_FOREACH(cdc_dev, &p_cdc_acm_obj->cdc_devices_list, list_entry) {
-        const usb_device_desc_t *device_desc;
-        ESP_ERROR_CHECK(usb_host_get_device_descriptor(cdc_dev->dev_hdl, &device_desc));
-        if ((vid == device_desc->idVendor || vid == CDC_HOST_ANY_VID) &&
-                (pid == device_desc->idProduct || pid == CDC_HOST_ANY_PID)) {
-            // Return path 1:
-            (*dev)->dev_hdl = cdc_dev->dev_hdl;
-            return ESP_OK;
-        }
+    if (cdc_acm_open_devs_reserve(vid, pid, intf_bit, sibling, *dev)) {
+        // Return path 1:
+        return ESP_OK;
+    }
+    if (sibling) {
+        // The sibling is already open, there is nothing to wait for
+        free(*dev);
+        *dev = NULL;
+        return ESP_ERR_NOT_FOUND;
     }
 
     // Second, poll connected devices until new device is connected or timeout
@@ -293,15 +550,23 @@ static esp_err_t cdc_acm_find_and_open_usb_device(uint16_t vid, uint16_t pid, in
 
     do {
         ESP_LOGD(TAG, "Checking list of connected USB devices");
-        uint8_t dev_addr_list[10];
+        uint8_t dev_addr_list[CDC_HOST_MAX_DEVICES];
         int num_of_devices;
         ESP_ERROR_CHECK(usb_host_device_addr_list_fill(sizeof(dev_addr_list), dev_addr_list, &num_of_devices));
 
         // Go through device address list and find the one we are looking for
         for (int i = 0; i < num_of_devices; i++) {
+            const uint8_t addr = dev_addr_list[i];
+            CDC_ACM_ENTER_CRITICAL();
+            const bool opened = (p_cdc_acm_obj->open_devs[addr].dev_hdl != NULL);
+            CDC_ACM_EXIT_CRITICAL();
+            if (opened) {
+                continue; // Already opened by this driver, it is in the table
+            }
+
             usb_device_handle_t current_device;
             // Open USB device
-            if (usb_host_device_open(p_cdc_acm_obj->cdc_acm_client_hdl, dev_addr_list[i], &current_device) != ESP_OK) {
+            if (usb_host_device_open(p_cdc_acm_obj->cdc_acm_client_hdl, addr, &current_device) != ESP_OK) {
                 continue; // In case we failed to open this device, continue with next one in the list
             }
             assert(current_device);
@@ -309,14 +574,37 @@ static esp_err_t cdc_acm_find_and_open_usb_device(uint16_t vid, uint16_t pid, in
             ESP_ERROR_CHECK(usb_host_get_device_descriptor(current_device, &device_desc));
             if ((vid == device_desc->idVendor || vid == CDC_HOST_ANY_VID) &&
                     (pid == device_desc->idProduct || pid == CDC_HOST_ANY_PID)) {
-                // Return path 2:
-                (*dev)->dev_hdl = current_device;
-                return ESP_OK;
+                // Add it to the table, unless another task opened it meanwhile
+                CDC_ACM_ENTER_CRITICAL();
+                cdc_acm_addr_entry_t *entry = &p_cdc_acm_obj->open_devs[addr];
+                const bool added = (entry->dev_hdl == NULL);
+                if (added) {
+                    entry->dev_hdl = current_device;
+                    entry->vid = device_desc->idVendor;
+                    entry->pid = device_desc->idProduct;
+                    entry->intf_mask = intf_bit;
+                }
+                CDC_ACM_EXIT_CRITICAL();
+                if (added) {
+                    // Return path 2:
+                    (*dev)->dev_hdl = current_device;
+                    (*dev)->dev_addr = addr;
+                    (*dev)->intf_bit = intf_bit;
+                    return ESP_OK;
+                }
             }
             usb_host_device_close(p_cdc_acm_obj->cdc_acm_client_hdl, current_device);
         }
+
+        // Another task might have opened the device meanwhile
+        if (cdc_acm_open_devs_reserve(vid, pid, intf_bit, NULL, *dev)) {
+            return ESP_OK;
+        }
+        if (xTaskCheckForTimeOut(&connection_timeout, &timeout_ticks) != pdFALSE) {
+            break; // Don't wait for the next poll when it would be past the timeout
+        }
         vTaskDelay(pdMS_TO_TICKS(50));
-    } while (xTaskCheckForTimeOut(&connection_timeout, &timeout_ticks) == pdFALSE);
+    } while (1);
 
     // Timeout was reached, clean-up
     free(*dev);
@@ -364,6 +652,7 @@ esp_err_t cdc_acm_host_install(const cdc_acm_host_driver_config_t *driver_config
     cdc_acm_obj->open_close_mutex = mutex;
     cdc_acm_obj->cdc_acm_client_hdl = usb_client;
     cdc_acm_obj->new_dev_cb = driver_config->new_dev_cb;
+    cdc_acm_obj->driver_task_h = driver_task_h;
 
     // Between 1st call of this function and following section, another task might try to install this driver:
     // Make sure that there is only one instance of this driver in the system
@@ -407,10 +696,11 @@ esp_err_t cdc_acm_host_uninstall()
     cdc_acm_obj_t *cdc_acm_obj = p_cdc_acm_obj; // Save Driver's handle to temporary handle
     CDC_ACM_EXIT_CRITICAL();
 
-    xSemaphoreTake(p_cdc_acm_obj->open_close_mutex, portMAX_DELAY); // Wait for all open/close calls to finish
+    xSemaphoreTake(p_cdc_acm_obj->open_close_mutex, portMAX_DELAY); // Wait for other uninstall calls to finish
 
     CDC_ACM_ENTER_CRITICAL();
-    if (SLIST_EMPTY(&p_cdc_acm_obj->cdc_devices_list)) { // Check that device list is empty (all devices closed)
+    // Check that device list is empty (all devices closed) and no device is being opened or closed
+    if (SLIST_EMPTY(&p_cdc_acm_obj->cdc_devices_list) && p_cdc_acm_obj->open_close_cnt == 0) {
         p_cdc_acm_obj = NULL; // NULL static driver pointer: No open/close calls form this point
     } else {
         ret = ESP_ERR_INVALID_STATE;
@@ -446,6 +736,32 @@ esp_err_t cdc_acm_host_register_new_dev_callback(cdc_acm_new_dev_callback_t new_
     return ESP_OK;
 }
 
+esp_err_t cdc_acm_host_device_ids_get(size_t list_len, uint32_t *vid_pid_list, int *num_ret)
+{
+    CDC_ACM_CHECK(p_cdc_acm_obj, ESP_ERR_INVALID_STATE);
+    CDC_ACM_CHECK(vid_pid_list && num_ret, ESP_ERR_INVALID_ARG);
+
+    uint8_t dev_addr_list[CDC_HOST_MAX_DEVICES];
+    int num_of_devices;
+    ESP_RETURN_ON_ERROR(usb_host_device_addr_list_fill(sizeof(dev_addr_list), dev_addr_list, &num_of_devices), TAG,);
+
+    // Device descriptors are cached by USB Host Library: no USB traffic here
+    int num = 0;
+    for (int i = 0; i < num_of_devices && num < list_len; i++) {
+        usb_device_handle_t current_device;
+        if (usb_host_device_open(p_cdc_acm_obj->cdc_acm_client_hdl, dev_addr_list[i], &current_device) != ESP_OK) {
+            continue; // In case we failed to open this device, continue with next one in the list
+        }
+        const usb_device_desc_t *device_desc;
+        if (usb_host_get_device_descriptor(current_device, &device_desc) == ESP_OK) {
+            vid_pid_list[num++] = ((uint32_t)device_desc->idVendor << 16) | device_desc->idProduct;
+        }
+        usb_host_device_close(p_cdc_acm_obj->cdc_acm_client_hdl, current_device);
+    }
+    *num_ret = num;
+    return ESP_OK;
+}
+
 /**
  * @brief Free USB transfers used by this device
  *
@@ -458,18 +774,39 @@ static void cdc_acm_transfers_free(cdc_dev_t *cdc_dev)
     if (cdc_dev->notif.xfer != NULL) {
         usb_host_transfer_free(cdc_dev->notif.xfer);
     }
-    if (cdc_dev->data.in_xfer != NULL) {
-        cdc_acm_reset_in_transfer(cdc_dev);
-        usb_host_transfer_free(cdc_dev->data.in_xfer);
-    }
-    if (cdc_dev->data.out_xfer != NULL) {
-        if (cdc_dev->data.out_xfer->context != NULL) {
-            vSemaphoreDelete((SemaphoreHandle_t)cdc_dev->data.out_xfer->context);
+    if (cdc_dev->data.in_xfers != NULL) {
+        for (int i = 0; i < cdc_dev->data.in_xfer_cnt; i++) {
+            if (cdc_dev->data.in_xfers[i] != NULL) {
+                cdc_acm_reset_in_transfer(cdc_dev, cdc_dev->data.in_xfers[i]);
+                usb_host_transfer_free(cdc_dev->data.in_xfers[i]);
+            }
         }
-        if (cdc_dev->data.out_mux != NULL) {
-            vSemaphoreDelete(cdc_dev->data.out_mux);
+        free(cdc_dev->data.in_xfers);
+        cdc_dev->data.in_xfers = NULL;
+    }
+    free(cdc_dev->data.in_held);
+    cdc_dev->data.in_held = NULL;
+    if (cdc_dev->data.in_recovery.ctrl != NULL) {
+        usb_host_transfer_free(cdc_dev->data.in_recovery.ctrl);
+        cdc_dev->data.in_recovery.ctrl = NULL;
+    }
+    if (cdc_dev->data.out_slots != NULL) {
+        for (int i = 0; i < cdc_dev->data.out_slot_cnt; i++) {
+            if (cdc_dev->data.out_slots[i].xfer != NULL) {
+                usb_host_transfer_free(cdc_dev->data.out_slots[i].xfer);
+            }
         }
-        usb_host_transfer_free(cdc_dev->data.out_xfer);
+        free(cdc_dev->data.out_slots);
+        cdc_dev->data.out_slots = NULL;
+    }
+    if (cdc_dev->data.out_free != NULL) {
+        vSemaphoreDelete(cdc_dev->data.out_free);
+    }
+    if (cdc_dev->data.out_done != NULL) {
+        vSemaphoreDelete(cdc_dev->data.out_done);
+    }
+    if (cdc_dev->data.out_mux != NULL) {
+        vSemaphoreDelete(cdc_dev->data.out_mux);
     }
     if (cdc_dev->ctrl_transfer != NULL) {
         if (cdc_dev->ctrl_transfer->context != NULL) {
@@ -489,14 +826,16 @@ static void cdc_acm_transfers_free(cdc_dev_t *cdc_dev)
  * @param[in] notif_ep_desc Pointer to notification EP descriptor
  * @param[in] in_ep_desc-   Pointer to data IN EP descriptor
  * @param[in] in_buf_len    Length of data IN buffer
+ * @param[in] in_xfer_num   Number of data IN transfers
  * @param[in] out_ep_desc   Pointer to data OUT EP descriptor
  * @param[in] out_buf_len   Length of data OUT buffer
+ * @param[in] out_xfer_num  Number of data OUT transfers
  * @return
  *     - ESP_OK:            Success
  *     - ESP_ERR_NO_MEM:    Not enough memory for transfers and semaphores allocation
  *     - ESP_ERR_NOT_FOUND: IN or OUT endpoints were not found in the selected interface
  */
-static esp_err_t cdc_acm_transfers_allocate(cdc_dev_t *cdc_dev, const usb_ep_desc_t *notif_ep_desc, const usb_ep_desc_t *in_ep_desc, size_t in_buf_len, const usb_ep_desc_t *out_ep_desc, size_t out_buf_len)
+static esp_err_t cdc_acm_transfers_allocate(cdc_dev_t *cdc_dev, const usb_ep_desc_t *notif_ep_desc, const usb_ep_desc_t *in_ep_desc, size_t in_buf_len, uint8_t in_xfer_num, const usb_ep_desc_t *out_ep_desc, size_t out_buf_len, uint8_t out_xfer_num)
 {
     assert(in_ep_desc);
     assert(out_ep_desc);
@@ -527,36 +866,55 @@ static esp_err_t cdc_acm_transfers_allocate(cdc_dev_t *cdc_dev, const usb_ep_des
     cdc_dev->ctrl_mux = xSemaphoreCreateMutex();
     ESP_GOTO_ON_FALSE(cdc_dev->ctrl_mux, ESP_ERR_NO_MEM, err, TAG,);
 
-    // 3. Setup IN data transfer (if it is required (in_buf_len > 0))
+    // 3. Setup IN data transfers (if it is required (in_buf_len > 0))
     if (in_buf_len != 0) {
-        ESP_GOTO_ON_ERROR(
-            usb_host_transfer_alloc(in_buf_len, 0, &cdc_dev->data.in_xfer),
-            err, TAG,
-        );
-        assert(cdc_dev->data.in_xfer);
-        cdc_dev->data.in_xfer->callback = in_xfer_cb;
-        cdc_dev->data.in_xfer->num_bytes = in_buf_len;
-        cdc_dev->data.in_xfer->bEndpointAddress = in_ep_desc->bEndpointAddress;
-        cdc_dev->data.in_xfer->device_handle = cdc_dev->dev_hdl;
-        cdc_dev->data.in_xfer->context = cdc_dev;
+        cdc_dev->data.in_xfers = calloc(in_xfer_num, sizeof(usb_transfer_t *));
+        ESP_GOTO_ON_FALSE(cdc_dev->data.in_xfers, ESP_ERR_NO_MEM, err, TAG,);
+        cdc_dev->data.in_held = calloc(in_xfer_num, sizeof(usb_transfer_t *));
+        ESP_GOTO_ON_FALSE(cdc_dev->data.in_held, ESP_ERR_NO_MEM, err, TAG,);
+        cdc_dev->data.in_xfer_cnt = in_xfer_num;
         cdc_dev->data.in_mps = USB_EP_DESC_GET_MPS(in_ep_desc);
-        cdc_dev->data.in_data_buffer_base = cdc_dev->data.in_xfer->data_buffer;
+        for (int i = 0; i < in_xfer_num; i++) {
+            ESP_GOTO_ON_ERROR(
+                usb_host_transfer_alloc(in_buf_len, 0, &cdc_dev->data.in_xfers[i]),
+                err, TAG,
+            );
+            usb_transfer_t *in_xfer = cdc_dev->data.in_xfers[i];
+            assert(in_xfer);
+            in_xfer->callback = in_xfer_cb;
+            in_xfer->num_bytes = in_buf_len;
+            in_xfer->bEndpointAddress = in_ep_desc->bEndpointAddress;
+            in_xfer->device_handle = cdc_dev->dev_hdl;
+            in_xfer->context = cdc_dev;
+        }
+        cdc_dev->data.in_data_buffer_base = cdc_dev->data.in_xfers[0]->data_buffer;
     }
 
-    // 4. Setup OUT bulk transfer (if it is required (out_buf_len > 0))
+    // 4. Setup pool of OUT bulk transfers (if it is required (out_buf_len > 0))
     if (out_buf_len != 0) {
-        ESP_GOTO_ON_ERROR(
-            usb_host_transfer_alloc(out_buf_len, 0, &cdc_dev->data.out_xfer),
-            err, TAG,
-        );
-        assert(cdc_dev->data.out_xfer);
-        cdc_dev->data.out_xfer->device_handle = cdc_dev->dev_hdl;
-        cdc_dev->data.out_xfer->context = xSemaphoreCreateBinary();
-        ESP_GOTO_ON_FALSE(cdc_dev->data.out_xfer->context, ESP_ERR_NO_MEM, err, TAG,);
+        cdc_dev->data.out_slots = calloc(out_xfer_num, sizeof(cdc_out_slot_t));
+        ESP_GOTO_ON_FALSE(cdc_dev->data.out_slots, ESP_ERR_NO_MEM, err, TAG,);
+        cdc_dev->data.out_slot_cnt = out_xfer_num;
+        for (int i = 0; i < out_xfer_num; i++) {
+            cdc_out_slot_t *slot = &cdc_dev->data.out_slots[i];
+            ESP_GOTO_ON_ERROR(
+                usb_host_transfer_alloc(out_buf_len, 0, &slot->xfer),
+                err, TAG,
+            );
+            assert(slot->xfer);
+            slot->cdc_dev = cdc_dev;
+            slot->xfer->device_handle = cdc_dev->dev_hdl;
+            slot->xfer->bEndpointAddress = out_ep_desc->bEndpointAddress;
+            slot->xfer->callback = out_data_xfer_cb;
+            slot->xfer->context = slot;
+        }
+        cdc_dev->data.out_mps = USB_EP_DESC_GET_MPS(out_ep_desc);
+        cdc_dev->data.out_free = xSemaphoreCreateCounting(out_xfer_num, out_xfer_num);
+        ESP_GOTO_ON_FALSE(cdc_dev->data.out_free, ESP_ERR_NO_MEM, err, TAG,);
+        cdc_dev->data.out_done = xSemaphoreCreateCounting(out_xfer_num, 0);
+        ESP_GOTO_ON_FALSE(cdc_dev->data.out_done, ESP_ERR_NO_MEM, err, TAG,);
         cdc_dev->data.out_mux = xSemaphoreCreateMutex();
         ESP_GOTO_ON_FALSE(cdc_dev->data.out_mux, ESP_ERR_NO_MEM, err, TAG,);
-        cdc_dev->data.out_xfer->bEndpointAddress = out_ep_desc->bEndpointAddress;
-        cdc_dev->data.out_xfer->callback = out_xfer_cb;
     }
     return ESP_OK;
 
@@ -568,14 +926,18 @@ err:
 esp_err_t cdc_acm_host_open(uint16_t vid, uint16_t pid, uint8_t interface_idx, const cdc_acm_host_device_config_t *dev_config, cdc_acm_dev_hdl_t *cdc_hdl_ret)
 {
     esp_err_t ret;
-    CDC_ACM_CHECK(p_cdc_acm_obj, ESP_ERR_INVALID_STATE);
     CDC_ACM_CHECK(dev_config, ESP_ERR_INVALID_ARG);
     CDC_ACM_CHECK(cdc_hdl_ret, ESP_ERR_INVALID_ARG);
 
-    xSemaphoreTake(p_cdc_acm_obj->open_close_mutex, portMAX_DELAY);
+    // Opens of different devices or interfaces run in parallel, uninstall waits for them
+    CDC_ACM_ENTER_CRITICAL();
+    CDC_ACM_CHECK_FROM_CRIT(p_cdc_acm_obj, ESP_ERR_INVALID_STATE);
+    p_cdc_acm_obj->open_close_cnt++;
+    CDC_ACM_EXIT_CRITICAL();
+
     // Find underlying USB device
     cdc_dev_t *cdc_dev;
-    ret =  cdc_acm_find_and_open_usb_device(vid, pid, dev_config->connection_timeout_ms, &cdc_dev);
+    ret =  cdc_acm_find_and_open_usb_device(vid, pid, interface_idx, dev_config->connection_timeout_ms, dev_config->sibling, &cdc_dev);
     if (ESP_OK != ret) {
         goto exit;
     }
@@ -601,6 +963,9 @@ esp_err_t cdc_acm_host_open(uint16_t vid, uint16_t pid, uint8_t interface_idx, c
     }
     cdc_dev->cdc_func_desc = cdc_info.func;
     cdc_dev->cdc_func_desc_cnt = cdc_info.func_cnt;
+    CDC_ACM_ENTER_CRITICAL();
+    cdc_acm_line_cache_take(cdc_dev);
+    CDC_ACM_EXIT_CRITICAL();
 
     // For CDC compliant devices, this driver provides default implementation of CDC-ACM specific functions.
     if (cdc_dev->cdc_func_desc_cnt > 1) {
@@ -612,36 +977,46 @@ esp_err_t cdc_acm_host_open(uint16_t vid, uint16_t pid, uint8_t interface_idx, c
 
     // The following line is here for backward compatibility with v1.0.*
     // where fixed size of IN buffer (equal to IN Maximum Packet Size) was used
-    const size_t in_buf_size = (dev_config->data_cb && (dev_config->in_buffer_size == 0)) ? USB_EP_DESC_GET_MPS(cdc_info.in_ep) : dev_config->in_buffer_size;
+    size_t in_buf_size = (dev_config->data_cb && (dev_config->in_buffer_size == 0)) ? USB_EP_DESC_GET_MPS(cdc_info.in_ep) : dev_config->in_buffer_size;
+
+    // IN transfers are a multiple of MPS, which is 512 bytes for bulk endpoints of high-speed devices
+    if (in_buf_size != 0 && cdc_info.in_ep) {
+        const uint16_t in_mps = USB_EP_DESC_GET_MPS(cdc_info.in_ep);
+        in_buf_size = ((in_buf_size + in_mps - 1) / in_mps) * in_mps;
+    }
 
     // Allocate USB transfers, claim CDC interfaces and return CDC-ACM handle
     ESP_GOTO_ON_ERROR(
-        cdc_acm_transfers_allocate(cdc_dev, cdc_info.notif_ep, cdc_info.in_ep, in_buf_size, cdc_info.out_ep, dev_config->out_buffer_size),
+        cdc_acm_transfers_allocate(cdc_dev, cdc_info.notif_ep, cdc_info.in_ep, in_buf_size,
+                                   dev_config->in_transfer_num ? dev_config->in_transfer_num : 1, cdc_info.out_ep, dev_config->out_buffer_size,
+                                   dev_config->out_transfer_num ? dev_config->out_transfer_num : 1),
         err, TAG,);
     ESP_GOTO_ON_ERROR(cdc_acm_start(cdc_dev, dev_config->event_cb, dev_config->data_cb, dev_config->user_arg), err, TAG,);
     *cdc_hdl_ret = (cdc_acm_dev_hdl_t)cdc_dev;
-    xSemaphoreGive(p_cdc_acm_obj->open_close_mutex);
+    CDC_ACM_ENTER_CRITICAL();
+    p_cdc_acm_obj->open_close_cnt--;
+    CDC_ACM_EXIT_CRITICAL();
     return ESP_OK;
 
 err:
     cdc_acm_device_remove(cdc_dev);
 exit:
-    xSemaphoreGive(p_cdc_acm_obj->open_close_mutex);
+    CDC_ACM_ENTER_CRITICAL();
+    p_cdc_acm_obj->open_close_cnt--;
+    CDC_ACM_EXIT_CRITICAL();
     *cdc_hdl_ret = NULL;
     return ret;
 }
 
 esp_err_t cdc_acm_host_close(cdc_acm_dev_hdl_t cdc_hdl)
 {
-    CDC_ACM_CHECK(p_cdc_acm_obj, ESP_ERR_INVALID_STATE);
     CDC_ACM_CHECK(cdc_hdl, ESP_ERR_INVALID_ARG);
 
-    xSemaphoreTake(p_cdc_acm_obj->open_close_mutex, portMAX_DELAY);
-
     // Make sure that the device is in the devices list (that it is not already closed)
     cdc_dev_t *cdc_dev;
     bool device_found = false;
     CDC_ACM_ENTER_CRITICAL();
+    CDC_ACM_CHECK_FROM_CRIT(p_cdc_acm_obj, ESP_ERR_INVALID_STATE);
     SLIST_FOREACH(cdc_dev, &p_cdc_acm_obj->cdc_devices_list, list_entry) {
         if (cdc_dev == (cdc_dev_t *)cdc_hdl) {
             device_found = true;
@@ -652,18 +1027,49 @@ esp_err_t cdc_acm_host_close(cdc_acm_dev_hdl_t cdc_hdl)
     // Device was not found in the cdc_devices_list; it was already closed, return OK
     if (!device_found) {
         CDC_ACM_EXIT_CRITICAL();
-        xSemaphoreGive(p_cdc_acm_obj->open_close_mutex);
         return ESP_OK;
     }
 
+    // Take it out of the list right away: a concurrent close of the same device returns, uninstall waits for this one
+    SLIST_REMOVE(&p_cdc_acm_obj->cdc_devices_list, cdc_dev, cdc_dev_s, list_entry);
+    p_cdc_acm_obj->open_close_cnt++;
+    cdc_acm_line_cache_save(cdc_dev);
+
     // No user callbacks from this point
     cdc_dev->notif.cb = NULL;
     cdc_dev->data.in_cb = NULL;
+
+    // Stop IN pipe recovery
+    if (cdc_dev->data.in_recovery.state == CDC_IN_RECOVERY_BACKOFF) {
+        p_cdc_acm_obj->in_recovery_cnt--;
+    }
+    cdc_dev->data.in_recovery.state = CDC_IN_RECOVERY_STOPPED;
     CDC_ACM_EXIT_CRITICAL();
 
+    // The client task may still hold this device in a walk of the devices list, unless the walk called us
+    if (xTaskGetCurrentTaskHandle() != p_cdc_acm_obj->driver_task_h) {
+        while (true) {
+            CDC_ACM_ENTER_CRITICAL();
+            const bool walking = p_cdc_acm_obj->list_walking;
+            CDC_ACM_EXIT_CRITICAL();
+            if (!walking) {
+                break;
+            }
+            vTaskDelay(1);
+        }
+    }
+
+    // Wait for a recovery attempt in flight: its CLEAR_FEATURE transfer is freed with the device and it resubmits IN transfers
+    TimeOut_t ctrl_timeout;
+    TickType_t ctrl_ticks = pdMS_TO_TICKS(CDC_ACM_CTRL_TIMEOUT_MS);
+    vTaskSetTimeOutState(&ctrl_timeout);
+    while (cdc_dev->data.in_recovery.ctrl_busy && xTaskCheckForTimeOut(&ctrl_timeout, &ctrl_ticks) == pdFALSE) {
+        vTaskDelay(1);
+    }
+
     // Cancel polling of BULK IN and INTERRUPT IN
-    if (cdc_dev->data.in_xfer) {
-        ESP_ERROR_CHECK(cdc_acm_reset_transfer_endpoint(cdc_dev->dev_hdl, cdc_dev->data.in_xfer));
+    if (cdc_dev->data.in_xfers) {
+        ESP_ERROR_CHECK(cdc_acm_reset_transfer_endpoint(cdc_dev->dev_hdl, cdc_dev->data.in_xfers[0]));
     }
     if (cdc_dev->notif.xfer != NULL) {
         ESP_ERROR_CHECK(cdc_acm_reset_transfer_endpoint(cdc_dev->dev_hdl, cdc_dev->notif.xfer));
@@ -675,12 +1081,10 @@ esp_err_t cdc_acm_host_close(cdc_acm_dev_hdl_t cdc_hdl)
         ESP_ERROR_CHECK(usb_host_interface_release(p_cdc_acm_obj->cdc_acm_client_hdl, cdc_dev->dev_hdl, cdc_dev->notif.intf_desc->bInterfaceNumber));
     }
 
+    cdc_acm_device_remove(cdc_dev);
     CDC_ACM_ENTER_CRITICAL();
-    SLIST_REMOVE(&p_cdc_acm_obj->cdc_devices_list, cdc_dev, cdc_dev_s, list_entry);
+    p_cdc_acm_obj->open_close_cnt--;
     CDC_ACM_EXIT_CRITICAL();
-
-    cdc_acm_device_remove(cdc_dev);
-    xSemaphoreGive(p_cdc_acm_obj->open_close_mutex);
     return ESP_OK;
 }
 
@@ -737,15 +1141,18 @@ static bool cdc_acm_is_transfer_completed(usb_transfer_t *transfer)
     return completed;
 }
 
-static void in_xfer_cb(usb_transfer_t *transfer)
+/**
+ * @brief Pass received data to the user
+ *
+ * @param[in] cdc_dev  Pointer to CDC device
+ * @param[in] transfer Completed IN transfer
+ */
+static void cdc_acm_in_xfer_deliver(cdc_dev_t *cdc_dev, usb_transfer_t *transfer)
 {
-    ESP_LOGD(TAG, "in xfer cb");
-    cdc_dev_t *cdc_dev = (cdc_dev_t *)transfer->context;
-
-    if (!cdc_acm_is_transfer_completed(transfer)) {
-        return;
+    if (cdc_dev->intf_func.rx_decode) {
+        // Vendor specific data stream, decoded in place by the driver
+        transfer->actual_num_bytes = cdc_dev->intf_func.rx_decode(cdc_dev, transfer->data_buffer, transfer->actual_num_bytes);
     }
-
     if (cdc_dev->data.in_cb) {
         const bool data_processed = cdc_dev->data.in_cb(transfer->data_buffer, transfer->actual_num_bytes, cdc_dev->cb_arg);
 
@@ -753,7 +1160,8 @@ static void in_xfer_cb(usb_transfer_t *transfer)
         // In order to save RAM and CPU time, the application can indicate that the received data was not processed and that the application expects more data.
         // In this case, the next received data must be appended to the existing buffer.
         // Since the data_buffer in usb_transfer_t is a constant pointer, we must cast away to const qualifier.
-        if (!data_processed) {
+        // With multiple IN transfers, later data is already queued in the other transfers, so it cannot be appended.
+        if (!data_processed && cdc_dev->data.in_xfer_cnt == 1) {
 #if !SOC_CACHE_INTERNAL_MEM_VIA_L1CACHE
             // In case the received data was not processed, the next RX data must be appended to current buffer
             uint8_t **ptr = (uint8_t **)(&(transfer->data_buffer));
@@ -776,7 +1184,7 @@ static void in_xfer_cb(usb_transfer_t *transfer)
                     cdc_dev->notif.cb(&serial_state_event, cdc_dev->cb_arg);
                 }
 
-                cdc_acm_reset_in_transfer(cdc_dev);
+                cdc_acm_reset_in_transfer(cdc_dev, transfer);
                 cdc_dev->serial_state.bOverRun = false;
             }
 #else
@@ -785,12 +1193,344 @@ static void in_xfer_cb(usb_transfer_t *transfer)
             ESP_LOGW(TAG, "RX buffer append is not yet supported on ESP32-P4!");
 #endif
         } else {
-            cdc_acm_reset_in_transfer(cdc_dev);
+            cdc_acm_reset_in_transfer(cdc_dev, transfer);
         }
     }
+}
+
+/**
+ * @brief Put IN transfer back on the endpoint, unless the user paused RX
+ *
+ * @param[in] cdc_dev  Pointer to CDC device
+ * @param[in] transfer Delivered IN transfer
+ */
+static void cdc_acm_in_xfer_rearm(cdc_dev_t *cdc_dev, usb_transfer_t *transfer)
+{
+    // The user might have paused RX from the data callback: keep the transfer, in front of the held ones, until it is resumed
+    CDC_ACM_ENTER_CRITICAL();
+    const bool paused = cdc_dev->data.in_paused;
+    if (paused) {
+        for (int i = cdc_dev->data.in_held_cnt; i > 0; i--) {
+            cdc_dev->data.in_held[i] = cdc_dev->data.in_held[i - 1];
+        }
+        cdc_dev->data.in_held[0] = transfer;
+        cdc_dev->data.in_held_cnt++;
+        cdc_dev->data.in_held_delivered = true;
+    }
+    const bool recovering = (cdc_dev->data.in_recovery.state != CDC_IN_RECOVERY_IDLE);
+    CDC_ACM_EXIT_CRITICAL();
+    if (paused) {
+        ESP_LOGD(TAG, "BULK IN paused");
+        return;
+    }
+    if (recovering) {
+        return; // Submitted when the recovery restarts polling
+    }
 
     ESP_LOGD(TAG, "Submitting poll for BULK IN transfer");
-    usb_host_transfer_submit(cdc_dev->data.in_xfer);
+    usb_host_transfer_submit(transfer);
+}
+
+static void cdc_acm_in_xfers_drain(cdc_dev_t *cdc_dev)
+{
+    while (1) {
+        CDC_ACM_ENTER_CRITICAL();
+        if (cdc_dev->data.in_paused || cdc_dev->data.in_held_cnt == 0) {
+            CDC_ACM_EXIT_CRITICAL();
+            return;
+        }
+        usb_transfer_t *transfer = cdc_dev->data.in_held[0];
+        const bool delivered = cdc_dev->data.in_held_delivered;
+        cdc_dev->data.in_held_cnt--;
+        for (int i = 0; i < cdc_dev->data.in_held_cnt; i++) {
+            cdc_dev->data.in_held[i] = cdc_dev->data.in_held[i + 1];
+        }
+        cdc_dev->data.in_held_delivered = false;
+        CDC_ACM_EXIT_CRITICAL();
+
+        if (!delivered) {
+            cdc_acm_in_xfer_deliver(cdc_dev, transfer);
+        }
+        cdc_acm_in_xfer_rearm(cdc_dev, transfer);
+    }
+}
+
+/**
+ * @brief Schedule the next IN pipe recovery attempt
+ *
+ * @note Must be called from a critical section
+ * @param[in] cdc_dev Pointer to CDC device
+ * @return false if the retries are used up
+ */
+static bool cdc_acm_in_recovery_schedule(cdc_dev_t *cdc_dev)
+{
+    if (cdc_dev->data.in_recovery.attempt >= CDC_ACM_IN_RECOVERY_RETRIES) {
+        cdc_dev->data.in_recovery.state = CDC_IN_RECOVERY_STOPPED;
+        cdc_dev->data.in_recovery.stats.recovery_failures++;
+        return false;
+    }
+    TickType_t backoff = 0;
+    if (cdc_dev->data.in_recovery.attempt > 0) {
+        backoff = pdMS_TO_TICKS(CDC_ACM_IN_RECOVERY_BACKOFF_MS << (cdc_dev->data.in_recovery.attempt - 1));
+        if (backoff == 0) {
+            backoff = 1;
+        }
+    }
+    cdc_dev->data.in_recovery.attempt++;
+    cdc_dev->data.in_recovery.due = xTaskGetTickCount() + backoff;
+    cdc_dev->data.in_recovery.state = CDC_IN_RECOVERY_BACKOFF;
+    p_cdc_acm_obj->in_recovery_cnt++;
+    return true;
+}
+
+/**
+ * @brief Handle a failed IN transfer
+ *
+ * The first error halts and flushes the IN endpoint. Once all IN transfers are back, a recovery attempt is scheduled.
+ *
+ * @param[in] cdc_dev  Pointer to CDC device
+ * @param[in] transfer IN transfer that did not complete
+ */
+static void cdc_acm_in_recovery_on_error(cdc_dev_t *cdc_dev, usb_transfer_t *transfer)
+{
+    if (transfer->status == USB_TRANSFER_STATUS_NO_DEVICE) {
+        return; // Nothing to recover, user is notified about device disconnection from usb_event_cb
+    }
+    const bool canceled = (transfer->status == USB_TRANSFER_STATUS_CANCELED);
+    bool flush = false;
+    bool given_up = false;
+
+    CDC_ACM_ENTER_CRITICAL();
+    switch (cdc_dev->data.in_recovery.state) {
+    case CDC_IN_RECOVERY_IDLE:
+        if (canceled) {
+            break; // Canceled by the driver, eg. while closing the device
+        }
+        cdc_dev->data.in_recovery.stats.errors++;
+        cdc_dev->data.in_recovery.started = xTaskGetTickCount();
+        cdc_dev->data.in_recovery.state = CDC_IN_RECOVERY_FLUSHING;
+        // All IN transfers, except this one and the held ones, are still on the endpoint
+        cdc_dev->data.in_recovery.pending = cdc_dev->data.in_xfer_cnt - cdc_dev->data.in_held_cnt - 1;
+        flush = true;
+        break;
+    case CDC_IN_RECOVERY_FLUSHING:
+        if (!canceled) {
+            cdc_dev->data.in_recovery.stats.errors++;
+        }
+        cdc_dev->data.in_recovery.pending--;
+        break;
+    default:
+        break;
+    }
+    if (cdc_dev->data.in_recovery.state == CDC_IN_RECOVERY_FLUSHING && cdc_dev->data.in_recovery.pending == 0) {
+        given_up = !cdc_acm_in_recovery_schedule(cdc_dev);
+    }
+    CDC_ACM_EXIT_CRITICAL();
+
+    if (flush) {
+        // Halt and flush the endpoint, the other IN transfers return as canceled
+        ESP_LOGW(TAG, "BULK IN error %d, recovering", transfer->status);
+        usb_host_endpoint_halt(cdc_dev->dev_hdl, transfer->bEndpointAddress);
+        usb_host_endpoint_flush(cdc_dev->dev_hdl, transfer->bEndpointAddress);
+    }
+    if (given_up) {
+        ESP_LOGE(TAG, "BULK IN recovery failed");
+    }
+}
+
+/**
+ * @brief Clear the halt condition of the IN endpoint, on the host and on the device
+ *
+ * The caller moved the recovery from BACKOFF to CLEARING and set ctrl_busy, so a close waits for this attempt.
+ *
+ * @param[in] cdc_dev Pointer to CDC device
+ */
+static void cdc_acm_in_recovery_clear_halt(cdc_dev_t *cdc_dev)
+{
+    const uint8_t ep_addr = cdc_dev->data.in_xfers[0]->bEndpointAddress;
+    esp_err_t ret = usb_host_endpoint_clear(cdc_dev->dev_hdl, ep_addr);
+
+    usb_transfer_t *ctrl = cdc_dev->data.in_recovery.ctrl;
+    if (ret == ESP_OK && ctrl == NULL) {
+        ret = usb_host_transfer_alloc(sizeof(usb_setup_packet_t), 0, &ctrl);
+        if (ret == ESP_OK) {
+            ctrl->device_handle = cdc_dev->dev_hdl;
+            ctrl->bEndpointAddress = 0;
+            ctrl->callback = in_recovery_ctrl_cb;
+            ctrl->context = cdc_dev;
+            ctrl->timeout_ms = CDC_ACM_CTRL_TIMEOUT_MS;
+            cdc_dev->data.in_recovery.ctrl = ctrl;
+        }
+    }
+    if (ret == ESP_OK) {
+        usb_setup_packet_t *req = (usb_setup_packet_t *)ctrl->data_buffer;
+        req->bmRequestType = USB_BM_REQUEST_TYPE_DIR_OUT | USB_BM_REQUEST_TYPE_TYPE_STANDARD | USB_BM_REQUEST_TYPE_RECIP_ENDPOINT;
+        req->bRequest = USB_B_REQUEST_CLEAR_FEATURE;
+        req->wValue = USB_W_VALUE_FEATURE_ENDPOINT_HALT;
+        req->wIndex = ep_addr;
+        req->wLength = 0;
+        ctrl->num_bytes = sizeof(usb_setup_packet_t);
+
+        // A close in the meantime stopped the recovery, do not start a request it would not wait for
+        CDC_ACM_ENTER_CRITICAL();
+        const bool stopped = (cdc_dev->data.in_recovery.state != CDC_IN_RECOVERY_CLEARING);
+        if (stopped) {
+            cdc_dev->data.in_recovery.ctrl_busy = false;
+        }
+        CDC_ACM_EXIT_CRITICAL();
+        if (stopped) {
+            return;
+        }
+        ret = usb_host_transfer_submit_control(p_cdc_acm_obj->cdc_acm_client_hdl, ctrl);
+    }
+    if (ret != ESP_OK) {
+        CDC_ACM_ENTER_CRITICAL();
+        cdc_dev->data.in_recovery.ctrl_busy = false;
+        const bool given_up = (cdc_dev->data.in_recovery.state == CDC_IN_RECOVERY_CLEARING) &&
+                              !cdc_acm_in_recovery_schedule(cdc_dev);
+        CDC_ACM_EXIT_CRITICAL();
+        if (given_up) {
+            ESP_LOGE(TAG, "BULK IN recovery failed");
+        }
+    }
+}
+
+static TickType_t cdc_acm_in_recovery_run(cdc_acm_obj_t *cdc_acm_obj)
+{
+    CDC_ACM_ENTER_CRITICAL();
+    const bool scheduled = cdc_acm_obj->in_recovery_cnt > 0;
+    CDC_ACM_EXIT_CRITICAL();
+    if (!scheduled) {
+        return portMAX_DELAY;
+    }
+
+    cdc_dev_t *cdc_dev;
+    cdc_dev_t *tcdc_dev;
+    cdc_acm_list_walk(cdc_acm_obj, true);
+    SLIST_FOREACH_SAFE(cdc_dev, &cdc_acm_obj->cdc_devices_list, list_entry, tcdc_dev) {
+        CDC_ACM_ENTER_CRITICAL();
+        const bool due = (cdc_dev->data.in_recovery.state == CDC_IN_RECOVERY_BACKOFF) &&
+                         ((int32_t)(xTaskGetTickCount() - cdc_dev->data.in_recovery.due) >= 0);
+        if (due) {
+            // Claim the attempt under the same lock, from here on a close waits for ctrl_busy
+            cdc_acm_obj->in_recovery_cnt--;
+            cdc_dev->data.in_recovery.state = CDC_IN_RECOVERY_CLEARING;
+            cdc_dev->data.in_recovery.ctrl_busy = true;
+        }
+        CDC_ACM_EXIT_CRITICAL();
+        if (due) {
+            cdc_acm_in_recovery_clear_halt(cdc_dev);
+        }
+    }
+    cdc_acm_list_walk(cdc_acm_obj, false);
+
+    // Failed attempts above are rescheduled, so look for the nearest one after all attempts ran
+    TickType_t timeout = portMAX_DELAY;
+    const TickType_t now = xTaskGetTickCount();
+    CDC_ACM_ENTER_CRITICAL();
+    SLIST_FOREACH(cdc_dev, &cdc_acm_obj->cdc_devices_list, list_entry) {
+        if (cdc_dev->data.in_recovery.state == CDC_IN_RECOVERY_BACKOFF) {
+            const int32_t wait = (int32_t)(cdc_dev->data.in_recovery.due - now);
+            const TickType_t ticks = (wait > 0) ? (TickType_t)wait : 0;
+            if (ticks < timeout) {
+                timeout = ticks;
+            }
+        }
+    }
+    CDC_ACM_EXIT_CRITICAL();
+    return timeout;
+}
+
+static void in_recovery_ctrl_cb(usb_transfer_t *transfer)
+{
+    ESP_LOGD(TAG, "in recovery ctrl cb");
+    cdc_dev_t *cdc_dev = (cdc_dev_t *)transfer->context;
+    const bool cleared = (transfer->status == USB_TRANSFER_STATUS_COMPLETED);
+    bool restart = false;
+    bool given_up = false;
+    uint32_t elapsed_ms = 0;
+
+    CDC_ACM_ENTER_CRITICAL();
+    if (cdc_dev->data.in_recovery.state == CDC_IN_RECOVERY_CLEARING) {
+        if (cleared) {
+            elapsed_ms = pdTICKS_TO_MS(xTaskGetTickCount() - cdc_dev->data.in_recovery.started);
+            cdc_acm_host_rx_stats_t *stats = &cdc_dev->data.in_recovery.stats;
+            stats->recoveries++;
+            stats->last_recovery_ms = elapsed_ms;
+            if (elapsed_ms > stats->max_recovery_ms) {
+                stats->max_recovery_ms = elapsed_ms;
+            }
+            cdc_dev->data.in_recovery.state = CDC_IN_RECOVERY_IDLE;
+            restart = true;
+        } else if (transfer->status == USB_TRANSFER_STATUS_NO_DEVICE) {
+            cdc_dev->data.in_recovery.state = CDC_IN_RECOVERY_STOPPED;
+        } else {
+            given_up = !cdc_acm_in_recovery_schedule(cdc_dev);
+        }
+    }
+    // Closing (STOPPED) or failed: nothing to resubmit, release the close waiting for us
+    if (!restart) {
+        cdc_dev->data.in_recovery.ctrl_busy = false;
+    }
+    CDC_ACM_EXIT_CRITICAL();
+
+    if (given_up) {
+        ESP_LOGE(TAG, "BULK IN recovery failed");
+    }
+    if (!restart) {
+        return;
+    }
+    ESP_LOGI(TAG, "BULK IN recovered in %"PRIu32" ms", elapsed_ms);
+
+    // Poll again with all IN transfers that are not held, held ones are submitted on resume
+    for (int i = 0; i < cdc_dev->data.in_xfer_cnt; i++) {
+        usb_transfer_t *in_xfer = cdc_dev->data.in_xfers[i];
+        bool held = false;
+        CDC_ACM_ENTER_CRITICAL();
+        for (int j = 0; j < cdc_dev->data.in_held_cnt; j++) {
+            if (cdc_dev->data.in_held[j] == in_xfer) {
+                held = true;
+                break;
+            }
+        }
+        CDC_ACM_EXIT_CRITICAL();
+        if (!held) {
+            cdc_acm_reset_in_transfer(cdc_dev, in_xfer);
+            usb_host_transfer_submit(in_xfer);
+        }
+    }
+
+    // Only now may a close cancel the IN transfers
+    CDC_ACM_ENTER_CRITICAL();
+    cdc_dev->data.in_recovery.ctrl_busy = false;
+    CDC_ACM_EXIT_CRITICAL();
+}
+
+static void in_xfer_cb(usb_transfer_t *transfer)
+{
+    ESP_LOGD(TAG, "in xfer cb");
+    cdc_dev_t *cdc_dev = (cdc_dev_t *)transfer->context;
+
+    if (!cdc_acm_is_transfer_completed(transfer)) {
+        cdc_acm_in_recovery_on_error(cdc_dev, transfer);
+        return;
+    }
+    cdc_dev->data.in_recovery.attempt = 0; // Data got through, the pipe is healthy
+
+    // Keep the completion order: while RX is paused or older data waits for delivery, hold this transfer too
+    CDC_ACM_ENTER_CRITICAL();
+    const bool hold = cdc_dev->data.in_paused || (cdc_dev->data.in_held_cnt > 0);
+    if (hold) {
+        cdc_dev->data.in_held[cdc_dev->data.in_held_cnt++] = transfer;
+    }
+    CDC_ACM_EXIT_CRITICAL();
+    if (hold) {
+        ESP_LOGD(TAG, "BULK IN held");
+        return;
+    }
+
+    cdc_acm_in_xfer_deliver(cdc_dev, transfer);
+    cdc_acm_in_xfer_rearm(cdc_dev, transfer);
 }
 
 static void notif_xfer_cb(usb_transfer_t *transfer)
@@ -798,7 +1538,25 @@ static void notif_xfer_cb(usb_transfer_t *transfer)
     ESP_LOGD(TAG, "notif xfer cb");
     cdc_dev_t *cdc_dev = (cdc_dev_t *)transfer->context;
 
-    if (cdc_acm_is_transfer_completed(transfer)) {
+    if (!cdc_acm_is_transfer_completed(transfer)) {
+        return;
+    }
+
+    if (cdc_dev->intf_func.notif_decode) {
+        // Vendor specific notification, decoded by the driver
+        cdc_acm_uart_state_t serial_state = cdc_dev->serial_state;
+        if (cdc_dev->intf_func.notif_decode(cdc_dev, transfer->data_buffer, transfer->actual_num_bytes, &serial_state)
+                && serial_state.val != cdc_dev->serial_state.val) {
+            cdc_dev->serial_state = serial_state;
+            if (cdc_dev->notif.cb) {
+                const cdc_acm_host_dev_event_data_t serial_state_event = {
+                    .type = CDC_ACM_HOST_SERIAL_STATE,
+                    .data.serial_state = serial_state
+                };
+                cdc_dev->notif.cb(&serial_state_event, cdc_dev->cb_arg);
+            }
+        }
+    } else {
         cdc_notification_t *notif = (cdc_notification_t *)transfer->data_buffer;
         switch (notif->bNotificationCode) {
         case USB_CDC_NOTIF_NETWORK_CONNECTION: {
@@ -828,11 +1586,11 @@ static void notif_xfer_cb(usb_transfer_t *transfer)
             ESP_LOG_BUFFER_HEX(TAG, transfer->data_buffer, transfer->actual_num_bytes);
             break;
         }
-
-        // Start polling for new data again
-        ESP_LOGD(TAG, "Submitting poll for INTR IN transfer");
-        usb_host_transfer_submit(cdc_dev->notif.xfer);
     }
+
+    // Start polling for new data again
+    ESP_LOGD(TAG, "Submitting poll for INTR IN transfer");
+    usb_host_transfer_submit(cdc_dev->notif.xfer);
 }
 
 static void out_xfer_cb(usb_transfer_t *transfer)
@@ -842,6 +1600,98 @@ static void out_xfer_cb(usb_transfer_t *transfer)
     xSemaphoreGive((SemaphoreHandle_t)transfer->context);
 }
 
+static void out_data_xfer_cb(usb_transfer_t *transfer)
+{
+    ESP_LOGD(TAG, "out xfer cb");
+    cdc_out_slot_t *slot = (cdc_out_slot_t *)transfer->context;
+    assert(slot);
+    const esp_err_t status = (transfer->status == USB_TRANSFER_STATUS_COMPLETED && transfer->actual_num_bytes == transfer->num_bytes)
+                             ? ESP_OK : ESP_ERR_INVALID_RESPONSE;
+    const size_t sent = transfer->actual_num_bytes;
+    cdc_acm_tx_callback_t done_cb = slot->done_cb;
+    void *done_arg = slot->done_arg;
+
+    // Return the transfer to the pool before reporting, so the callback can submit new data
+    CDC_ACM_ENTER_CRITICAL();
+    slot->busy = false;
+    slot->cdc_dev->data.out_queued -= transfer->num_bytes;
+    CDC_ACM_EXIT_CRITICAL();
+    xSemaphoreGive(slot->cdc_dev->data.out_free);
+
+    if (done_cb) {
+        done_cb(status, sent, done_arg);
+    }
+}
+
+/**
+ * @brief Submit one chunk of data from the OUT transfer pool
+ *
+ * @param[in] cdc_dev    Pointer to CDC device
+ * @param[in] data       Data to be sent, at most out_buffer_size bytes
+ * @param[in] data_len   Data length
+ * @param[in] zlp        Append a zero length packet if data_len is a multiple of MPS
+ * @param[in] done_cb    Completion callback
+ * @param[in] done_arg   Argument for completion callback
+ * @param[in] timeout_ms Time to wait for a free transfer, also used as transfer timeout
+ * @return
+ *   - ESP_OK: Transfer submitted
+ *   - ESP_ERR_TIMEOUT: No transfer became free in time
+ *   - Else: Error from usb_host_transfer_submit()
+ */
+static esp_err_t cdc_acm_data_tx_submit(cdc_dev_t *cdc_dev, const uint8_t *data, size_t data_len, bool zlp,
+                                        cdc_acm_tx_callback_t done_cb, void *done_arg, uint32_t timeout_ms)
+{
+    if (xSemaphoreTake(cdc_dev->data.out_free, pdMS_TO_TICKS(timeout_ms)) != pdTRUE) {
+        return ESP_ERR_TIMEOUT;
+    }
+
+    // The semaphore guarantees there is a free slot
+    cdc_out_slot_t *slot = NULL;
+    CDC_ACM_ENTER_CRITICAL();
+    for (int i = 0; i < cdc_dev->data.out_slot_cnt; i++) {
+        if (!cdc_dev->data.out_slots[i].busy) {
+            slot = &cdc_dev->data.out_slots[i];
+            slot->busy = true;
+            break;
+        }
+    }
+    cdc_dev->data.out_queued += data_len;
+    CDC_ACM_EXIT_CRITICAL();
+    assert(slot);
+
+    memcpy(slot->xfer->data_buffer, data, data_len);
+    slot->xfer->num_bytes = data_len;
+    slot->xfer->timeout_ms = timeout_ms;
+    slot->xfer->flags = (zlp && (data_len % cdc_dev->data.out_mps == 0)) ? USB_TRANSFER_FLAG_ZERO_PACK : 0;
+    slot->done_cb = done_cb;
+    slot->done_arg = done_arg;
+
+    ESP_LOGD(TAG, "Submitting BULK OUT transfer");
+    esp_err_t ret = usb_host_transfer_submit(slot->xfer);
+    if (ret != ESP_OK) {
+        CDC_ACM_ENTER_CRITICAL();
+        slot->busy = false;
+        cdc_dev->data.out_queued -= data_len;
+        CDC_ACM_EXIT_CRITICAL();
+        xSemaphoreGive(cdc_dev->data.out_free);
+    }
+    return ret;
+}
+
+/**
+ * @brief Completion callback of chunks submitted by cdc_acm_host_data_tx_blocking()
+ */
+static void out_blocking_done_cb(esp_err_t status, size_t data_len, void *arg)
+{
+    cdc_dev_t *cdc_dev = (cdc_dev_t *)arg;
+    if (status != ESP_OK) {
+        CDC_ACM_ENTER_CRITICAL();
+        cdc_dev->data.out_err = status;
+        CDC_ACM_EXIT_CRITICAL();
+    }
+    xSemaphoreGive(cdc_dev->data.out_done);
+}
+
 static void usb_event_cb(const usb_host_client_event_msg_t *event_msg, void *arg)
 {
     switch (event_msg->event) {
@@ -849,6 +1699,7 @@ static void usb_event_cb(const usb_host_client_event_msg_t *event_msg, void *arg
         // Guard p_cdc_acm_obj->new_dev_cb from concurrent access
         ESP_LOGD(TAG, "New device connected");
         CDC_ACM_ENTER_CRITICAL();
+        cdc_acm_line_cache_forget(event_msg->new_dev.address);
         cdc_acm_new_dev_callback_t _new_dev_cb = p_cdc_acm_obj->new_dev_cb;
         CDC_ACM_EXIT_CRITICAL();
 
@@ -869,7 +1720,16 @@ static void usb_event_cb(const usb_host_client_event_msg_t *event_msg, void *arg
         cdc_dev_t *cdc_dev;
         cdc_dev_t *tcdc_dev;
         // We are using 'SAFE' version of 'SLIST_FOREACH' which enables user to close the disconnected device in the callback
+        // Other tasks closing a device wait for the end of the walk before they free it
+        cdc_acm_list_walk(p_cdc_acm_obj, true);
         SLIST_FOREACH_SAFE(cdc_dev, &p_cdc_acm_obj->cdc_devices_list, list_entry, tcdc_dev) {
+            if (cdc_dev->dev_hdl == event_msg->dev_gone.dev_hdl) {
+                // Not remembered when it is closed
+                CDC_ACM_ENTER_CRITICAL();
+                memset(&cdc_dev->line_state, 0, sizeof(cdc_line_state_t));
+                cdc_acm_line_cache_forget(cdc_dev->dev_addr);
+                CDC_ACM_EXIT_CRITICAL();
+            }
             if (cdc_dev->dev_hdl == event_msg->dev_gone.dev_hdl && cdc_dev->notif.cb) {
                 // The suddenly disconnected device was opened by this driver: inform user about this
                 const cdc_acm_host_dev_event_data_t disconn_event = {
@@ -879,6 +1739,7 @@ static void usb_event_cb(const usb_host_client_event_msg_t *event_msg, void *arg
                 cdc_dev->notif.cb(&disconn_event, cdc_dev->cb_arg);
             }
         }
+        cdc_acm_list_walk(p_cdc_acm_obj, false);
         break;
     }
     default:
@@ -889,46 +1750,171 @@ static void usb_event_cb(const usb_host_client_event_msg_t *event_msg, void *arg
 
 esp_err_t cdc_acm_host_data_tx_blocking(cdc_acm_dev_hdl_t cdc_hdl, const uint8_t *data, size_t data_len, uint32_t timeout_ms)
 {
-    esp_err_t ret;
+    esp_err_t ret = ESP_OK;
     CDC_ACM_CHECK(cdc_hdl, ESP_ERR_INVALID_ARG);
     cdc_dev_t *cdc_dev = (cdc_dev_t *)cdc_hdl;
     CDC_ACM_CHECK(data && (data_len > 0), ESP_ERR_INVALID_ARG);
-    CDC_ACM_CHECK(cdc_dev->data.out_xfer, ESP_ERR_NOT_SUPPORTED); // Device was opened as read-only.
-    CDC_ACM_CHECK(data_len <= cdc_dev->data.out_xfer->data_buffer_size, ESP_ERR_INVALID_SIZE);
+    CDC_ACM_CHECK(cdc_dev->data.out_slots, ESP_ERR_NOT_SUPPORTED); // Device was opened as read-only.
 
-    // Take OUT mutex and fill the OUT transfer
-    BaseType_t taken = xSemaphoreTake(cdc_dev->data.out_mux, pdMS_TO_TICKS(timeout_ms));
+    // Take OUT mutex: blocking transmissions are not interleaved with each other
+    TimeOut_t time_out;
+    TickType_t ticks_to_wait = pdMS_TO_TICKS(timeout_ms);
+    vTaskSetTimeOutState(&time_out);
+    BaseType_t taken = xSemaphoreTake(cdc_dev->data.out_mux, ticks_to_wait);
     if (taken != pdTRUE) {
         return ESP_ERR_TIMEOUT;
     }
+    // Collect the completions of transfers that timed out before: a late one must not be counted for this transmit
+    while (cdc_dev->data.out_done_owed > 0) {
+        xTaskCheckForTimeOut(&time_out, &ticks_to_wait);
+        if (xSemaphoreTake(cdc_dev->data.out_done, ticks_to_wait) != pdTRUE) {
+            xSemaphoreGive(cdc_dev->data.out_mux);
+            return ESP_ERR_TIMEOUT;
+        }
+        cdc_dev->data.out_done_owed--;
+    }
+    cdc_dev->data.out_err = ESP_OK;
+
+    // Submit the data in chunks, the pool keeps the next chunk queued while the previous one is on the bus
+    const size_t chunk_max = cdc_dev->data.out_slots[0].xfer->data_buffer_size;
+    size_t submitted = 0;
+    int in_flight = 0;
+    while (submitted < data_len) {
+        const size_t chunk_len = (data_len - submitted < chunk_max) ? data_len - submitted : chunk_max;
+        const bool last = (submitted + chunk_len == data_len);
+        xTaskCheckForTimeOut(&time_out, &ticks_to_wait);
+        ret = cdc_acm_data_tx_submit(cdc_dev, data + submitted, chunk_len, last, out_blocking_done_cb, cdc_dev, pdTICKS_TO_MS(ticks_to_wait));
+        if (ret != ESP_OK) {
+            break;
+        }
+        submitted += chunk_len;
+        in_flight++;
+    }
 
-    ESP_LOGD(TAG, "Submitting BULK OUT transfer");
-    SemaphoreHandle_t transfer_finished_semaphore = (SemaphoreHandle_t)cdc_dev->data.out_xfer->context;
-    xSemaphoreTake(transfer_finished_semaphore, 0); // Make sure the semaphore is taken before we submit new transfer
-
-    memcpy(cdc_dev->data.out_xfer->data_buffer, data, data_len);
-    cdc_dev->data.out_xfer->num_bytes = data_len;
-    cdc_dev->data.out_xfer->timeout_ms = timeout_ms;
-    ESP_GOTO_ON_ERROR(usb_host_transfer_submit(cdc_dev->data.out_xfer), unblock, TAG,);
+    // Wait for OUT transfers completion
+    while (in_flight > 0) {
+        xTaskCheckForTimeOut(&time_out, &ticks_to_wait);
+        if (xSemaphoreTake(cdc_dev->data.out_done, ticks_to_wait) != pdTRUE) {
+            // Resetting the endpoint will cause all in-progress transfers to complete
+            cdc_acm_reset_transfer_endpoint(cdc_dev->dev_hdl, cdc_dev->data.out_slots[0].xfer);
+            ret = ESP_ERR_TIMEOUT;
+            // The completions come from the client task: wait for them, the next transmit collects the ones that are late
+            while (in_flight > 0 && xSemaphoreTake(cdc_dev->data.out_done, pdMS_TO_TICKS(CDC_ACM_TX_FLUSH_TIMEOUT_MS)) == pdTRUE) {
+                in_flight--;
+            }
+            cdc_dev->data.out_done_owed += in_flight;
+            break;
+        }
+        in_flight--;
+    }
 
-    // Wait for OUT transfer completion
-    taken = xSemaphoreTake(transfer_finished_semaphore, pdMS_TO_TICKS(timeout_ms));
-    if (!taken) {
-        cdc_acm_reset_transfer_endpoint(cdc_dev->dev_hdl, cdc_dev->data.out_xfer); // Resetting the endpoint will cause all in-progress transfers to complete
+    if (ret == ESP_ERR_TIMEOUT) {
         ESP_LOGW(TAG, "TX transfer timeout");
-        ret = ESP_ERR_TIMEOUT;
-        goto unblock;
+    } else if (ret == ESP_OK && cdc_dev->data.out_err != ESP_OK) {
+        ESP_LOGE(TAG, "Bulk OUT transfer error");
+        ret = cdc_dev->data.out_err;
     }
-
-    ESP_GOTO_ON_FALSE(cdc_dev->data.out_xfer->status == USB_TRANSFER_STATUS_COMPLETED, ESP_ERR_INVALID_RESPONSE, unblock, TAG, "Bulk OUT transfer error");
-    ESP_GOTO_ON_FALSE(cdc_dev->data.out_xfer->actual_num_bytes == data_len, ESP_ERR_INVALID_RESPONSE, unblock, TAG, "Incorrect number of bytes transferred");
-    ret = ESP_OK;
-
-unblock:
     xSemaphoreGive(cdc_dev->data.out_mux);
     return ret;
 }
 
+esp_err_t cdc_acm_host_data_tx_async(cdc_acm_dev_hdl_t cdc_hdl, const uint8_t *data, size_t data_len, cdc_acm_tx_callback_t tx_cb, void *user_arg)
+{
+    CDC_ACM_CHECK(cdc_hdl, ESP_ERR_INVALID_ARG);
+    cdc_dev_t *cdc_dev = (cdc_dev_t *)cdc_hdl;
+    CDC_ACM_CHECK(data && (data_len > 0), ESP_ERR_INVALID_ARG);
+    CDC_ACM_CHECK(cdc_dev->data.out_slots, ESP_ERR_NOT_SUPPORTED); // Device was opened as read-only.
+    CDC_ACM_CHECK(data_len <= cdc_dev->data.out_slots[0].xfer->data_buffer_size, ESP_ERR_INVALID_SIZE);
+
+    const esp_err_t ret = cdc_acm_data_tx_submit(cdc_dev, data, data_len, true, tx_cb, user_arg, 0);
+    return (ret == ESP_ERR_TIMEOUT) ? ESP_ERR_NO_MEM : ret;
+}
+
+esp_err_t cdc_acm_host_data_tx_queued(cdc_acm_dev_hdl_t cdc_hdl, size_t *queued_ret)
+{
+    CDC_ACM_CHECK(cdc_hdl && queued_ret, ESP_ERR_INVALID_ARG);
+    cdc_dev_t *cdc_dev = (cdc_dev_t *)cdc_hdl;
+    CDC_ACM_CHECK(cdc_dev->data.out_slots, ESP_ERR_NOT_SUPPORTED); // Device was opened as read-only.
+
+    CDC_ACM_ENTER_CRITICAL();
+    *queued_ret = cdc_dev->data.out_queued;
+    CDC_ACM_EXIT_CRITICAL();
+    return ESP_OK;
+}
+
+esp_err_t cdc_acm_host_data_rx_pause(cdc_acm_dev_hdl_t cdc_hdl)
+{
+    CDC_ACM_CHECK(cdc_hdl, ESP_ERR_INVALID_ARG);
+    cdc_dev_t *cdc_dev = (cdc_dev_t *)cdc_hdl;
+    CDC_ACM_CHECK(cdc_dev->data.in_xfers, ESP_ERR_NOT_SUPPORTED); // Device was opened as write-only.
+
+    CDC_ACM_ENTER_CRITICAL();
+    cdc_dev->data.in_paused = true;
+    CDC_ACM_EXIT_CRITICAL();
+    return ESP_OK;
+}
+
+esp_err_t cdc_acm_host_data_rx_resume(cdc_acm_dev_hdl_t cdc_hdl)
+{
+    CDC_ACM_CHECK(cdc_hdl, ESP_ERR_INVALID_ARG);
+    cdc_dev_t *cdc_dev = (cdc_dev_t *)cdc_hdl;
+    CDC_ACM_CHECK(cdc_dev->data.in_xfers, ESP_ERR_NOT_SUPPORTED); // Device was opened as write-only.
+
+    usb_transfer_t *resubmit = NULL;
+    bool drain = false;
+    CDC_ACM_ENTER_CRITICAL();
+    cdc_dev->data.in_paused = false;
+    if (cdc_dev->data.in_held_cnt == 1 && cdc_dev->data.in_held_delivered) {
+        // Only the transfer that was being processed when RX got paused: start polling again from here
+        // While the IN pipe is recovering, the recovery submits it
+        if (cdc_dev->data.in_recovery.state == CDC_IN_RECOVERY_IDLE) {
+            resubmit = cdc_dev->data.in_held[0];
+        }
+        cdc_dev->data.in_held_cnt = 0;
+        cdc_dev->data.in_held_delivered = false;
+    } else if (cdc_dev->data.in_held_cnt > 0) {
+        // Received data is waiting, it must reach the user from the driver task
+        p_cdc_acm_obj->in_drain_pending = true;
+        drain = true;
+    }
+    CDC_ACM_EXIT_CRITICAL();
+
+    if (resubmit) {
+        ESP_LOGD(TAG, "Submitting poll for BULK IN transfer");
+        return usb_host_transfer_submit(resubmit);
+    }
+    if (drain) {
+        return usb_host_client_unblock(p_cdc_acm_obj->cdc_acm_client_hdl);
+    }
+    return ESP_OK;
+}
+
+esp_err_t cdc_acm_host_data_rx_stats_get(cdc_acm_dev_hdl_t cdc_hdl, cdc_acm_host_rx_stats_t *stats_ret)
+{
+    CDC_ACM_CHECK(cdc_hdl && stats_ret, ESP_ERR_INVALID_ARG);
+    cdc_dev_t *cdc_dev = (cdc_dev_t *)cdc_hdl;
+    CDC_ACM_CHECK(cdc_dev->data.in_xfers, ESP_ERR_NOT_SUPPORTED); // Device was opened as write-only.
+
+    CDC_ACM_ENTER_CRITICAL();
+    *stats_ret = cdc_dev->data.in_recovery.stats;
+    CDC_ACM_EXIT_CRITICAL();
+    return ESP_OK;
+}
+
+esp_err_t cdc_acm_host_data_mps_get(cdc_acm_dev_hdl_t cdc_hdl, uint16_t *in_mps, uint16_t *out_mps)
+{
+    CDC_ACM_CHECK(cdc_hdl, ESP_ERR_INVALID_ARG);
+    cdc_dev_t *cdc_dev = (cdc_dev_t *)cdc_hdl;
+
+    if (in_mps != NULL) {
+        *in_mps = cdc_dev->data.in_xfers ? cdc_dev->data.in_mps : 0;
+    }
+    if (out_mps != NULL) {
+        *out_mps = cdc_dev->data.out_slots ? cdc_dev->data.out_mps : 0;
+    }
+    return ESP_OK;
+}
+
 esp_err_t cdc_acm_host_send_custom_request(cdc_acm_dev_hdl_t cdc_hdl, uint8_t bmRequestType, uint8_t bRequest, uint16_t wValue, uint16_t wIndex, uint16_t wLength, uint8_t *data)
 {
     CDC_ACM_CHECK(cdc_hdl, ESP_ERR_INVALID_ARG);
@@ -972,6 +1958,7 @@ esp_err_t cdc_acm_host_send_custom_request(cdc_acm_dev_hdl_t cdc_hdl, uint8_t bm
         goto unblock;
     }
 
+    ESP_GOTO_ON_FALSE(cdc_dev->ctrl_transfer->status != USB_TRANSFER_STATUS_STALL, ESP_ERR_NOT_SUPPORTED, unblock, TAG, "Control request not supported");
     ESP_GOTO_ON_FALSE(cdc_dev->ctrl_transfer->status == USB_TRANSFER_STATUS_COMPLETED, ESP_ERR_INVALID_RESPONSE, unblock, TAG, "Control transfer error");
     ESP_GOTO_ON_FALSE(cdc_dev->ctrl_transfer->actual_num_bytes == cdc_dev->ctrl_transfer->num_bytes, ESP_ERR_INVALID_RESPONSE, unblock, TAG, "Incorrect number of bytes transferred");
 
@@ -986,6 +1973,20 @@ unblock:
     return ret;
 }
 
+esp_err_t cdc_acm_host_device_info_get(cdc_acm_dev_hdl_t cdc_hdl, const usb_device_desc_t **device_desc_ret, usb_device_info_t *dev_info_ret)
+{
+    CDC_ACM_CHECK(cdc_hdl, ESP_ERR_INVALID_ARG);
+    cdc_dev_t *cdc_dev = (cdc_dev_t *)cdc_hdl;
+
+    if (device_desc_ret != NULL) {
+        ESP_RETURN_ON_ERROR(usb_host_get_device_descriptor(cdc_dev->dev_hdl, device_desc_ret), TAG,);
+    }
+    if (dev_info_ret != NULL) {
+        ESP_RETURN_ON_ERROR(usb_host_device_info(cdc_dev->dev_hdl, dev_info_ret), TAG,);
+    }
+    return ESP_OK;
+}
+
 esp_err_t cdc_acm_host_protocols_get(cdc_acm_dev_hdl_t cdc_hdl, cdc_comm_protocol_t *comm, cdc_data_protocol_t *data)
 {
     CDC_ACM_CHECK(cdc_hdl, ESP_ERR_INVALID_ARG);
@@ -32,7 +32,7 @@ static const char *TAG = "cdc_acm_compliant";
  * @return
  *    - ESP_OK: Success
  *    - ESP_ERR_INVALID_ARG:      Invalid device or request
- *    - ESP_ERR_NOT_SUPPORTED:    Device does not have management element
+ *    - ESP_ERR_NOT_SUPPORTED:    Device does not have management element, or stalled the request
  *    - ESP_ERR_INVALID_SIZE:     wLength does not fit CTRL data buffer
  *    - ESP_ERR_TIMED_OUT:        Request timeout (5 seconds)
  *    - ESP_ERR_INVALID_RESPONSE: Control transfer failed
@@ -71,6 +71,11 @@ const uint8_t ttl232_config_desc[] = {
     0x05, 0x81, 0x02, 0x40, 0x00, 0x00, 0x07, 0x05, 0x02, 0x02, 0x40, 0x00, 0x00,
 };
 
+// FT232H (bcdDevice 0x0900), single port high-speed chip, connected at full speed: same configuration as TTL232RG
+const uint8_t ft232h_device_desc[] = {
+    0x12, 0x01, 0x00, 0x02, 0x00, 0x00, 0x00, 0x40, 0x03, 0x04, 0x14, 0x60, 0x00, 0x09, 0x01, 0x02, 0x03, 0x01,
+};
+
 // CP210x
 // (only FS)
 const uint8_t cp210x_device_desc[] = {
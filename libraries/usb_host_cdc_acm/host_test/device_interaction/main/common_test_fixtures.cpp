@@ -30,6 +30,8 @@ typedef struct {
     struct {
         usb_transfer_t *out_xfer;
         usb_transfer_t *in_xfer;
+        int in_xfer_num;
+        int out_xfer_num;
         uint8_t in_bEndpointAddress;
         uint8_t out_bEndpointAddress;
     } data;
@@ -86,18 +88,22 @@ static esp_err_t _test_create_cmock_expectations(uint8_t dev_address, uint8_t in
         cdc_dev_expects->notif.xfer = nullptr;
     }
 
-    // Check, if IN data transfer is allocated
+    // Check, if IN data transfers are allocated, default is one transfer
     if (dev_config->in_buffer_size) {
         cdc_dev_expects->data.in_xfer = reinterpret_cast<usb_transfer_t *>(&data_in_xfer);
+        cdc_dev_expects->data.in_xfer_num = dev_config->in_transfer_num ? dev_config->in_transfer_num : 1;
     } else {
         cdc_dev_expects->data.in_xfer = nullptr;
+        cdc_dev_expects->data.in_xfer_num = 0;
     }
 
-    // Check if OUT data transfer is allocated
+    // Check if OUT data transfers are allocated, default pool is one transfer
     if (dev_config->out_buffer_size) {
         cdc_dev_expects->data.out_xfer = reinterpret_cast<usb_transfer_t *>(&data_out_xfer);
+        cdc_dev_expects->data.out_xfer_num = dev_config->out_transfer_num ? dev_config->out_transfer_num : 1;
     } else {
         cdc_dev_expects->data.out_xfer = nullptr;
+        cdc_dev_expects->data.out_xfer_num = 0;
     }
 
     p_cdc_dev_expects = cdc_dev_expects;
@@ -178,13 +184,13 @@ esp_err_t test_cdc_acm_host_open(uint8_t dev_address, uint16_t vid, uint16_t pid
         usb_host_transfer_alloc_ExpectAnyArgsAndReturn(ESP_OK);
     }
 
-    //  Setup IN data transfer
-    if (dev_config->in_buffer_size) {
+    //  Setup IN data transfers
+    for (int i = 0; i < p_cdc_dev_expects->data.in_xfer_num; i++) {
         usb_host_transfer_alloc_ExpectAnyArgsAndReturn(ESP_OK);
     }
 
-    // Setup OUT bulk transfer
-    if (dev_config->out_buffer_size) {
+    // Setup pool of OUT bulk transfers
+    for (int i = 0; i < p_cdc_dev_expects->data.out_xfer_num; i++) {
         usb_host_transfer_alloc_ExpectAnyArgsAndReturn(ESP_OK);
     }
 
@@ -197,6 +203,11 @@ esp_err_t test_cdc_acm_host_open(uint8_t dev_address, uint16_t vid, uint16_t pid
     // Make sure that the interface_index has been claimed
     test_usb_host_interface_claim(interface_index);
 
+    // All IN data transfers are queued on the IN endpoint, the first one is expected with the interface claim
+    for (int i = 1; i < p_cdc_dev_expects->data.in_xfer_num; i++) {
+        usb_host_transfer_submit_ExpectAnyArgsAndReturn(ESP_OK);
+    }
+
     // Claim 2nd interface (if supported)
     if (p_cdc_dev_expects->notif.has_separate_interface) {
         test_usb_host_interface_claim(interface_index + 1);
@@ -238,15 +249,19 @@ esp_err_t test_cdc_acm_host_close(cdc_acm_dev_hdl_t *cdc_hdl, uint8_t interface_
         p_cdc_dev_expects->notif.xfer = nullptr;
     }
 
-    // Free in transfer
+    // Free in transfers
     if (p_cdc_dev_expects->data.in_xfer) {
-        usb_host_transfer_free_ExpectAnyArgsAndReturn(ESP_OK);
+        for (int i = 0; i < p_cdc_dev_expects->data.in_xfer_num; i++) {
+            usb_host_transfer_free_ExpectAnyArgsAndReturn(ESP_OK);
+        }
         p_cdc_dev_expects->data.in_xfer = nullptr;
     }
 
-    // Free out transfer
+    // Free out transfers
     if (p_cdc_dev_expects->data.out_xfer) {
-        usb_host_transfer_free_ExpectAnyArgsAndReturn(ESP_OK);
+        for (int i = 0; i < p_cdc_dev_expects->data.out_xfer_num; i++) {
+            usb_host_transfer_free_ExpectAnyArgsAndReturn(ESP_OK);
+        }
         p_cdc_dev_expects->data.out_xfer = nullptr;
     }
 
@@ -0,0 +1,369 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdio.h>
+#include <algorithm>
+#include <deque>
+#include <vector>
+#include <catch2/catch_test_macros.hpp>
+
+#include "descriptors/cdc_descriptors.hpp"
+#include "usb/cdc_acm_host.h"
+#include "esp_private/cdc_host_common.h"  // Function table of an open CDC device
+#include "mock_add_usb_device.h"
+#include "common_test_fixtures.hpp"
+
+extern "C" {
+#include "Mockusb_host.h"
+}
+
+/**
+ * @brief Bulk OUT transfers seen by the mocked USB Host stack
+ */
+struct submitted_out_xfer {
+    int num_bytes;
+    uint32_t flags;
+};
+static std::vector<submitted_out_xfer> submitted_out;
+
+/**
+ * @brief Record a submitted OUT transfer and complete it successfully
+ */
+static esp_err_t _record_out_transfer_mock_callback(usb_transfer_t *transfer, int call_count)
+{
+    if (transfer->bEndpointAddress & USB_B_ENDPOINT_ADDRESS_EP_DIR_MASK) {
+        return ESP_OK; // IN transfers are not part of this test
+    }
+    submitted_out.push_back({transfer->num_bytes, transfer->flags});
+    transfer->status = USB_TRANSFER_STATUS_COMPLETED;
+    transfer->actual_num_bytes = transfer->num_bytes;
+    transfer->callback(transfer);
+    return ESP_OK;
+}
+
+/**
+ * @brief Record a submitted OUT transfer and leave it in flight
+ */
+static std::vector<usb_transfer_t *> pending_out;
+static esp_err_t _hold_out_transfer_mock_callback(usb_transfer_t *transfer, int call_count)
+{
+    if (transfer->bEndpointAddress & USB_B_ENDPOINT_ADDRESS_EP_DIR_MASK) {
+        return ESP_OK; // IN transfers are not part of this test
+    }
+    submitted_out.push_back({transfer->num_bytes, transfer->flags});
+    pending_out.push_back(transfer);
+    return ESP_OK;
+}
+
+/**
+ * @brief Complete the oldest OUT transfer left in flight
+ */
+static void _complete_pending_out_transfer(void)
+{
+    usb_transfer_t *transfer = pending_out.front();
+    pending_out.erase(pending_out.begin());
+    transfer->status = USB_TRANSFER_STATUS_COMPLETED;
+    transfer->actual_num_bytes = transfer->num_bytes;
+    transfer->callback(transfer);
+}
+
+/**
+ * @brief Completion callback of asynchronous transmissions, counts completed bytes
+ */
+static void _tx_done_cb(esp_err_t status, size_t data_len, void *user_arg)
+{
+    REQUIRE(status == ESP_OK);
+    *static_cast<size_t *>(user_arg) += data_len;
+}
+
+/**
+ * @brief Model of the IN endpoint: transfers queued in submission order
+ */
+static std::deque<usb_transfer_t *> in_pipe;
+static esp_err_t _in_pipe_submit_mock_callback(usb_transfer_t *transfer, int call_count)
+{
+    if (transfer->bEndpointAddress & USB_B_ENDPOINT_ADDRESS_EP_DIR_MASK) {
+        in_pipe.push_back(transfer);
+    }
+    return ESP_OK;
+}
+
+/**
+ * @brief Mocked device sends one byte, which completes the oldest queued IN transfer
+ */
+static void _device_sends(uint8_t value)
+{
+    REQUIRE(!in_pipe.empty());
+    usb_transfer_t *transfer = in_pipe.front();
+    in_pipe.pop_front();
+    transfer->data_buffer[0] = value;
+    transfer->actual_num_bytes = 1;
+    transfer->status = USB_TRANSFER_STATUS_COMPLETED;
+    transfer->callback(transfer);
+}
+
+/**
+ * @brief Data callback, records received data and how many IN transfers stayed queued meanwhile
+ */
+static std::vector<uint8_t> received;
+static size_t armed_min;
+static cdc_acm_dev_hdl_t pause_dev;
+static bool _rx_cb(const uint8_t *data, size_t data_len, void *user_arg)
+{
+    received.insert(received.end(), data, data + data_len);
+    armed_min = std::min(armed_min, in_pipe.size());
+    if (pause_dev) {
+        REQUIRE(ESP_OK == cdc_acm_host_data_rx_pause(pause_dev));
+    }
+    return true;
+}
+
+/**
+ * @brief Vendor specific data stream of the test: 0xEC is not data
+ */
+static size_t _rx_decode(cdc_acm_dev_hdl_t cdc_hdl, uint8_t *data, size_t data_len)
+{
+    size_t out = 0;
+    for (size_t in = 0; in < data_len; in++) {
+        if (data[in] != 0xEC) {
+            data[out++] = data[in];
+        }
+    }
+    return out;
+}
+
+/**
+ * @brief Add mocked devices
+ *
+ * Mocked devices are defined by a device descriptor, a configuration descriptor and a device address
+ */
+static void _add_mocked_devices(void)
+{
+    // Init mocked devices list at the beginning of the test
+    usb_host_mock_dev_list_init();
+
+    // CP210x (FS descriptor), bulk endpoints with MPS 64
+    REQUIRE(ESP_OK == usb_host_mock_add_device(4, (const usb_device_desc_t *)cp210x_device_desc,
+                                               (const usb_config_desc_t *)cp210x_config_desc));
+}
+
+SCENARIO("Bulk transfers with mocked USB device")
+{
+    // We put the device adding to the SECTION, to run it just once, not repeatedly for all the following SECTIONs
+    SECTION("Add mocked devices") {
+        _add_mocked_devices();
+    }
+
+    GIVEN("Mocked device is added to the device list") {
+        // Install CDC-ACM driver
+        REQUIRE(ESP_OK == test_cdc_acm_host_install(nullptr));
+
+        cdc_acm_dev_hdl_t dev = nullptr;
+        const uint16_t vid = 0x10C4, pid = 0xEA60;
+        const uint8_t device_address = 4, interface_index = 0;
+        uint8_t tx_buf[250];
+        for (size_t i = 0; i < sizeof(tx_buf); i++) {
+            tx_buf[i] = (uint8_t)i;
+        }
+        submitted_out.clear();
+
+        SECTION("Long data is split into pipelined chunks, ZLP only on MPS aligned end") {
+            const cdc_acm_host_device_config_t dev_config = {
+                .connection_timeout_ms = 1000,
+                .out_buffer_size = 100,
+                .in_buffer_size = 100,
+                .event_cb = nullptr,
+                .data_cb = nullptr,
+                .user_arg = nullptr,
+                .out_transfer_num = 2,
+            };
+            REQUIRE(ESP_OK == test_cdc_acm_host_open(device_address, vid, pid, interface_index, &dev_config, &dev));
+            REQUIRE(dev != nullptr);
+
+            // 250 bytes: 100 + 100 + 50, no ZLP
+            for (int i = 0; i < 3; i++) {
+                usb_host_transfer_submit_ExpectAnyArgsAndReturn(ESP_OK);
+            }
+            usb_host_transfer_submit_AddCallback(_record_out_transfer_mock_callback);
+            REQUIRE(ESP_OK == cdc_acm_host_data_tx_blocking(dev, tx_buf, sizeof(tx_buf), 200));
+            REQUIRE(submitted_out.size() == 3);
+            REQUIRE(submitted_out[0].num_bytes == 100);
+            REQUIRE(submitted_out[1].num_bytes == 100);
+            REQUIRE(submitted_out[2].num_bytes == 50);
+            for (const auto &xfer : submitted_out) {
+                REQUIRE((xfer.flags & USB_TRANSFER_FLAG_ZERO_PACK) == 0);
+            }
+
+            // 164 bytes: 100 + 64, the last chunk is a multiple of MPS and must be terminated by a ZLP
+            submitted_out.clear();
+            for (int i = 0; i < 2; i++) {
+                usb_host_transfer_submit_ExpectAnyArgsAndReturn(ESP_OK);
+            }
+            usb_host_transfer_submit_AddCallback(_record_out_transfer_mock_callback);
+            REQUIRE(ESP_OK == cdc_acm_host_data_tx_blocking(dev, tx_buf, 164, 200));
+            REQUIRE(submitted_out.size() == 2);
+            REQUIRE((submitted_out[0].flags & USB_TRANSFER_FLAG_ZERO_PACK) == 0);
+            REQUIRE(submitted_out[1].num_bytes == 64);
+            REQUIRE((submitted_out[1].flags & USB_TRANSFER_FLAG_ZERO_PACK) != 0);
+
+            // Close the device
+            REQUIRE(ESP_OK == test_cdc_acm_host_close(&dev, interface_index));
+        }
+
+        SECTION("Asynchronous transmissions are queued until a transfer completes") {
+            const cdc_acm_host_device_config_t dev_config = {
+                .connection_timeout_ms = 1000,
+                .out_buffer_size = 100,
+                .in_buffer_size = 100,
+                .event_cb = nullptr,
+                .data_cb = nullptr,
+                .user_arg = nullptr,
+                .out_transfer_num = 2,
+            };
+            REQUIRE(ESP_OK == test_cdc_acm_host_open(device_address, vid, pid, interface_index, &dev_config, &dev));
+            REQUIRE(dev != nullptr);
+
+            size_t sent = 0;
+            size_t queued = 0;
+            REQUIRE(ESP_ERR_INVALID_SIZE == cdc_acm_host_data_tx_async(dev, tx_buf, 101, _tx_done_cb, &sent));
+
+            // Both transfers of the pool go in flight, the third transmission is refused
+            pending_out.clear();
+            usb_host_transfer_submit_ExpectAnyArgsAndReturn(ESP_OK);
+            usb_host_transfer_submit_ExpectAnyArgsAndReturn(ESP_OK);
+            usb_host_transfer_submit_AddCallback(_hold_out_transfer_mock_callback);
+            REQUIRE(ESP_OK == cdc_acm_host_data_tx_async(dev, tx_buf, 30, _tx_done_cb, &sent));
+            REQUIRE(ESP_OK == cdc_acm_host_data_tx_async(dev, tx_buf, 64, _tx_done_cb, &sent));
+            REQUIRE(ESP_ERR_NO_MEM == cdc_acm_host_data_tx_async(dev, tx_buf, 10, _tx_done_cb, &sent));
+            REQUIRE(ESP_OK == cdc_acm_host_data_tx_queued(dev, &queued));
+            REQUIRE(queued == 94);
+            REQUIRE((submitted_out[1].flags & USB_TRANSFER_FLAG_ZERO_PACK) != 0);
+
+            // Completing a transfer reports it and frees its slot
+            _complete_pending_out_transfer();
+            REQUIRE(sent == 30);
+            REQUIRE(ESP_OK == cdc_acm_host_data_tx_queued(dev, &queued));
+            REQUIRE(queued == 64);
+            usb_host_transfer_submit_ExpectAnyArgsAndReturn(ESP_OK);
+            usb_host_transfer_submit_AddCallback(_hold_out_transfer_mock_callback);
+            REQUIRE(ESP_OK == cdc_acm_host_data_tx_async(dev, tx_buf, 10, _tx_done_cb, &sent));
+
+            // All transmissions must be completed before the device is closed
+            _complete_pending_out_transfer();
+            _complete_pending_out_transfer();
+            REQUIRE(sent == 104);
+            REQUIRE(ESP_OK == cdc_acm_host_data_tx_queued(dev, &queued));
+            REQUIRE(queued == 0);
+
+            // Close the device
+            REQUIRE(ESP_OK == test_cdc_acm_host_close(&dev, interface_index));
+        }
+
+        SECTION("Multiple IN transfers keep the endpoint polled and deliver data in order") {
+            const cdc_acm_host_device_config_t dev_config = {
+                .connection_timeout_ms = 1000,
+                .out_buffer_size = 100,
+                .in_buffer_size = 64,
+                .event_cb = nullptr,
+                .data_cb = _rx_cb,
+                .user_arg = nullptr,
+                .out_transfer_num = 0,
+                .in_transfer_num = 3,
+            };
+            in_pipe.clear();
+            received.clear();
+            armed_min = SIZE_MAX;
+            pause_dev = nullptr;
+            usb_host_transfer_submit_AddCallback(_in_pipe_submit_mock_callback);
+            REQUIRE(ESP_OK == test_cdc_acm_host_open(device_address, vid, pid, interface_index, &dev_config, &dev));
+            REQUIRE(dev != nullptr);
+            REQUIRE(in_pipe.size() == 3);
+
+            // Every completed transfer is put back on the endpoint
+            for (uint8_t i = 0; i < 8; i++) {
+                usb_host_transfer_submit_ExpectAnyArgsAndReturn(ESP_OK);
+                _device_sends(i);
+            }
+            REQUIRE(received == std::vector<uint8_t> {0, 1, 2, 3, 4, 5, 6, 7});
+            REQUIRE(armed_min == 2);    // The endpoint was never left without a transfer
+            REQUIRE(in_pipe.size() == 3);
+
+            // Pausing RX from the data callback holds only that transfer, the others stay queued
+            pause_dev = dev;
+            usb_transfer_t *paused_xfer = in_pipe.front();
+            _device_sends(8);
+            pause_dev = nullptr;
+            REQUIRE(in_pipe.size() == 2);
+            usb_host_transfer_submit_ExpectAnyArgsAndReturn(ESP_OK);
+            REQUIRE(ESP_OK == cdc_acm_host_data_rx_resume(dev));
+            REQUIRE(in_pipe.size() == 3);
+            REQUIRE(in_pipe.back() == paused_xfer);
+
+            // The driver's rx_decode removes vendor specific bytes before the data callback
+            dev->intf_func.rx_decode = _rx_decode;
+            received.clear();
+            for (uint8_t value : {0xEC, 9, 0xEC, 10}) {
+                usb_host_transfer_submit_ExpectAnyArgsAndReturn(ESP_OK);
+                _device_sends(value);
+            }
+            REQUIRE(received == std::vector<uint8_t> {9, 10});
+
+            // Close the device
+            REQUIRE(ESP_OK == test_cdc_acm_host_close(&dev, interface_index));
+        }
+
+        SECTION("IN transfer error halts and flushes the endpoint for recovery") {
+            const cdc_acm_host_device_config_t dev_config = {
+                .connection_timeout_ms = 1000,
+                .out_buffer_size = 100,
+                .in_buffer_size = 64,
+                .event_cb = nullptr,
+                .data_cb = _rx_cb,
+                .user_arg = nullptr,
+                .out_transfer_num = 0,
+                .in_transfer_num = 2,
+            };
+            in_pipe.clear();
+            received.clear();
+            armed_min = SIZE_MAX;
+            pause_dev = nullptr;
+            usb_host_transfer_submit_AddCallback(_in_pipe_submit_mock_callback);
+            REQUIRE(ESP_OK == test_cdc_acm_host_open(device_address, vid, pid, interface_index, &dev_config, &dev));
+            REQUIRE(dev != nullptr);
+            REQUIRE(in_pipe.size() == 2);
+
+            // The oldest transfer stalls: the endpoint is halted and flushed, nothing is resubmitted
+            usb_transfer_t *stalled = in_pipe.front();
+            in_pipe.pop_front();
+            stalled->status = USB_TRANSFER_STATUS_STALL;
+            usb_host_endpoint_halt_ExpectAndReturn(nullptr, stalled->bEndpointAddress, ESP_OK);
+            usb_host_endpoint_halt_IgnoreArg_dev_hdl();
+            usb_host_endpoint_flush_ExpectAndReturn(nullptr, stalled->bEndpointAddress, ESP_OK);
+            usb_host_endpoint_flush_IgnoreArg_dev_hdl();
+            stalled->callback(stalled);
+
+            // The flushed transfer returns canceled, it is not resubmitted either
+            usb_transfer_t *flushed = in_pipe.front();
+            in_pipe.pop_front();
+            flushed->status = USB_TRANSFER_STATUS_CANCELED;
+            flushed->callback(flushed);
+            REQUIRE(in_pipe.empty());
+            REQUIRE(received.empty());
+
+            cdc_acm_host_rx_stats_t stats;
+            REQUIRE(ESP_OK == cdc_acm_host_data_rx_stats_get(dev, &stats));
+            REQUIRE(stats.errors == 1);
+            REQUIRE(stats.recoveries == 0);
+            REQUIRE(stats.recovery_failures == 0);
+
+            // Closing the device stops the recovery
+            REQUIRE(ESP_OK == test_cdc_acm_host_close(&dev, interface_index));
+        }
+
+        // Uninstall CDC-ACM driver
+        REQUIRE(ESP_OK == test_cdc_acm_host_uninstall());
+    }
+}
@@ -0,0 +1,148 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdio.h>
+#include <cstring>
+#include <vector>
+#include <catch2/catch_test_macros.hpp>
+
+#include "descriptors/cdc_descriptors.hpp"
+#include "usb/cdc_acm_host.h"
+#include "esp_private/cdc_host_common.h"  // Notification transfer and function table of an open CDC device
+#include "mock_add_usb_device.h"
+#include "common_test_fixtures.hpp"
+
+extern "C" {
+#include "Mockusb_host.h"
+}
+
+/**
+ * @brief Mocked USB Host stack accepts everything the driver does with an open device
+ */
+static esp_err_t _interface_mock_callback(usb_host_client_handle_t client_hdl, usb_device_handle_t dev_hdl, uint8_t bInterfaceNumber, int call_count)
+{
+    return ESP_OK;
+}
+static esp_err_t _interface_claim_mock_callback(usb_host_client_handle_t client_hdl, usb_device_handle_t dev_hdl, uint8_t bInterfaceNumber, uint8_t bAlternateSetting, int call_count)
+{
+    return ESP_OK;
+}
+static esp_err_t _endpoint_mock_callback(usb_device_handle_t dev_hdl, uint8_t bEndpointAddress, int call_count)
+{
+    return ESP_OK;
+}
+
+/**
+ * @brief Count submissions of the notification transfer
+ */
+static usb_transfer_t *notif_xfer;
+static int notif_submitted;
+static esp_err_t _transfer_submit_mock_callback(usb_transfer_t *transfer, int call_count)
+{
+    if (transfer == notif_xfer) {
+        notif_submitted++;
+    }
+    return ESP_OK;
+}
+
+/**
+ * @brief Serial states reported to the user
+ */
+static std::vector<uint16_t> serial_states;
+static void _event_cb(const cdc_acm_host_dev_event_data_t *event, void *user_ctx)
+{
+    if (event->type == CDC_ACM_HOST_SERIAL_STATE) {
+        serial_states.push_back(event->data.serial_state.val);
+    }
+}
+
+/**
+ * @brief Vendor specific notification of the test: the serial state in byte 0, nothing in an empty packet
+ */
+static bool _notif_decode(cdc_acm_dev_hdl_t cdc_hdl, const uint8_t *data, size_t data_len, cdc_acm_uart_state_t *serial_state)
+{
+    if (data_len == 0) {
+        return false;
+    }
+    serial_state->val = data[0];
+    return true;
+}
+
+/**
+ * @brief Mocked device sends a packet on its notification endpoint
+ */
+static void _device_notifies(const std::vector<uint8_t> &packet)
+{
+    REQUIRE(packet.size() <= notif_xfer->data_buffer_size);
+    memcpy(notif_xfer->data_buffer, packet.data(), packet.size());
+    notif_xfer->actual_num_bytes = packet.size();
+    notif_xfer->status = USB_TRANSFER_STATUS_COMPLETED;
+    notif_xfer->callback(notif_xfer);
+}
+
+SCENARIO("Notifications of mocked USB device")
+{
+    SECTION("Add mocked devices") {
+        usb_host_mock_dev_list_init();
+        // TinyUSB serial device, with a notification endpoint
+        REQUIRE(ESP_OK == usb_host_mock_add_device(1, (const usb_device_desc_t *)tusb_serial_device_device_desc_fs_hs,
+                                                   (const usb_config_desc_t *)tusb_serial_device_config_desc_hs));
+    }
+
+    GIVEN("Mocked device is added to the device list") {
+        REQUIRE(ESP_OK == test_cdc_acm_host_install(nullptr));
+
+        usb_host_device_open_Stub(usb_host_device_open_mock_callback);
+        usb_host_get_device_descriptor_Stub(usb_host_get_device_descriptor_mock_callback);
+        usb_host_device_close_Stub(usb_host_device_close_mock_callback);
+        usb_host_get_active_config_descriptor_Stub(usb_host_get_active_config_descriptor_mock_callback);
+        usb_host_device_addr_list_fill_Stub(usb_host_device_addr_list_fill_mock_callback);
+        usb_host_transfer_alloc_Stub(usb_host_transfer_alloc_mock_callback);
+        usb_host_transfer_free_Stub(usb_host_transfer_free_mock_callback);
+        usb_host_interface_claim_Stub(_interface_claim_mock_callback);
+        usb_host_interface_release_Stub(_interface_mock_callback);
+        usb_host_transfer_submit_Stub(_transfer_submit_mock_callback);
+        usb_host_endpoint_halt_Stub(_endpoint_mock_callback);
+        usb_host_endpoint_flush_Stub(_endpoint_mock_callback);
+        usb_host_endpoint_clear_Stub(_endpoint_mock_callback);
+
+        const cdc_acm_host_device_config_t dev_config = {
+            .connection_timeout_ms = 1,
+            .out_buffer_size = 64,
+            .in_buffer_size = 64,
+            .event_cb = _event_cb,
+            .data_cb = nullptr,
+            .user_arg = nullptr,
+        };
+        cdc_acm_dev_hdl_t dev = nullptr;
+        REQUIRE(ESP_OK == cdc_acm_host_open(0x303A, 0x4001, 0, &dev_config, &dev));
+        notif_xfer = dev->notif.xfer;
+        REQUIRE(notif_xfer != nullptr);
+        notif_submitted = 0;
+        serial_states.clear();
+
+        SECTION("Driver decodes vendor specific notifications") {
+            dev->intf_func.notif_decode = _notif_decode;
+
+            _device_notifies({0x81});
+            _device_notifies({0x81}); // Unchanged, not reported again
+            _device_notifies({});     // Not a serial state
+            _device_notifies({0x00});
+            REQUIRE(serial_states == std::vector<uint16_t> {0x0081, 0x0000});
+            REQUIRE(notif_submitted == 4);
+        }
+
+        REQUIRE(ESP_OK == cdc_acm_host_close(dev));
+
+        usb_host_interface_claim_Stub(nullptr);
+        usb_host_interface_release_Stub(nullptr);
+        usb_host_transfer_submit_Stub(nullptr);
+        usb_host_endpoint_halt_Stub(nullptr);
+        usb_host_endpoint_flush_Stub(nullptr);
+        usb_host_endpoint_clear_Stub(nullptr);
+        REQUIRE(ESP_OK == test_cdc_acm_host_uninstall());
+    }
+}
@@ -0,0 +1,212 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdio.h>
+#include <chrono>
+#include <set>
+#include <catch2/catch_test_macros.hpp>
+
+#include "descriptors/cdc_descriptors.hpp"
+#include "usb/cdc_acm_host.h"
+#include "esp_private/cdc_host_common.h"  // USB device handle of an open CDC device
+#include "mock_add_usb_device.h"
+#include "common_test_fixtures.hpp"
+
+extern "C" {
+#include "Mockusb_host.h"
+}
+
+// Number of identical devices behind (mocked) hubs, more than the former limit of 10
+static constexpr int scaling_devs_count = 40;
+static constexpr int scaling_rounds = 5;
+
+// Number of identical dual port FTDI devices
+static constexpr int dual_devs_count = 3;
+
+/**
+ * @brief Mocked USB Host stack accepts everything the driver does with an open device
+ */
+static esp_err_t _interface_mock_callback(usb_host_client_handle_t client_hdl, usb_device_handle_t dev_hdl, uint8_t bInterfaceNumber, int call_count)
+{
+    return ESP_OK;
+}
+static esp_err_t _interface_claim_mock_callback(usb_host_client_handle_t client_hdl, usb_device_handle_t dev_hdl, uint8_t bInterfaceNumber, uint8_t bAlternateSetting, int call_count)
+{
+    return ESP_OK;
+}
+static esp_err_t _endpoint_mock_callback(usb_device_handle_t dev_hdl, uint8_t bEndpointAddress, int call_count)
+{
+    return ESP_OK;
+}
+static esp_err_t _transfer_submit_mock_callback(usb_transfer_t *transfer, int call_count)
+{
+    return ESP_OK;
+}
+
+/**
+ * @brief Stub the USB Host stack, so any number of devices can be opened and closed
+ */
+static void _stub_usb_host(void)
+{
+    usb_host_device_open_Stub(usb_host_device_open_mock_callback);
+    usb_host_get_device_descriptor_Stub(usb_host_get_device_descriptor_mock_callback);
+    usb_host_device_close_Stub(usb_host_device_close_mock_callback);
+    usb_host_get_active_config_descriptor_Stub(usb_host_get_active_config_descriptor_mock_callback);
+    usb_host_device_addr_list_fill_Stub(usb_host_device_addr_list_fill_mock_callback);
+    usb_host_transfer_alloc_Stub(usb_host_transfer_alloc_mock_callback);
+    usb_host_transfer_free_Stub(usb_host_transfer_free_mock_callback);
+    usb_host_interface_claim_Stub(_interface_claim_mock_callback);
+    usb_host_interface_release_Stub(_interface_mock_callback);
+    usb_host_transfer_submit_Stub(_transfer_submit_mock_callback);
+    usb_host_endpoint_halt_Stub(_endpoint_mock_callback);
+    usb_host_endpoint_flush_Stub(_endpoint_mock_callback);
+    usb_host_endpoint_clear_Stub(_endpoint_mock_callback);
+}
+
+/**
+ * @brief Back to expectations for the other tests
+ */
+static void _unstub_usb_host(void)
+{
+    usb_host_interface_claim_Stub(nullptr);
+    usb_host_interface_release_Stub(nullptr);
+    usb_host_transfer_submit_Stub(nullptr);
+    usb_host_endpoint_halt_Stub(nullptr);
+    usb_host_endpoint_flush_Stub(nullptr);
+    usb_host_endpoint_clear_Stub(nullptr);
+}
+
+/**
+ * @brief Add mocked devices
+ *
+ * All CP210x with the same VID/PID, at consecutive addresses
+ */
+static void _add_mocked_devices(void)
+{
+    usb_host_mock_dev_list_init();
+    for (int addr = 1; addr <= scaling_devs_count; addr++) {
+        REQUIRE(ESP_OK == usb_host_mock_add_device(addr, (const usb_device_desc_t *)cp210x_device_desc,
+                                                   (const usb_config_desc_t *)cp210x_config_desc));
+    }
+}
+
+SCENARIO("Open and close many identical devices")
+{
+    SECTION("Add mocked devices") {
+        _add_mocked_devices();
+    }
+
+    GIVEN("Mocked devices are added to the device list") {
+        REQUIRE(ESP_OK == test_cdc_acm_host_install(nullptr));
+
+        _stub_usb_host();
+
+        const cdc_acm_host_device_config_t dev_config = {
+            .connection_timeout_ms = 1,
+            .out_buffer_size = 64,
+            .in_buffer_size = 64,
+            .event_cb = nullptr,
+            .data_cb = nullptr,
+            .user_arg = nullptr,
+            .out_transfer_num = 0,
+            .in_transfer_num = 0,
+        };
+
+        SECTION("Every open picks the next device with the same VID/PID") {
+            cdc_acm_dev_hdl_t devs[scaling_devs_count];
+            std::chrono::steady_clock::duration open_time{}, close_time{};
+
+            for (int round = 0; round < scaling_rounds; round++) {
+                auto start = std::chrono::steady_clock::now();
+                for (int i = 0; i < scaling_devs_count; i++) {
+                    REQUIRE(ESP_OK == cdc_acm_host_open(0x10C4, 0xEA60, 0, &dev_config, &devs[i]));
+                }
+                open_time += std::chrono::steady_clock::now() - start;
+
+                // All devices are in use, the next open finds none
+                cdc_acm_dev_hdl_t extra = nullptr;
+                REQUIRE(ESP_ERR_NOT_FOUND == cdc_acm_host_open(0x10C4, 0xEA60, 0, &dev_config, &extra));
+                REQUIRE(std::set<cdc_acm_dev_hdl_t>(devs, devs + scaling_devs_count).size() == scaling_devs_count);
+
+                start = std::chrono::steady_clock::now();
+                for (int i = 0; i < scaling_devs_count; i++) {
+                    REQUIRE(ESP_OK == cdc_acm_host_close(devs[i]));
+                }
+                close_time += std::chrono::steady_clock::now() - start;
+            }
+
+            const int ops = scaling_devs_count * scaling_rounds;
+            const double open_us = std::chrono::duration<double, std::micro>(open_time).count() / ops;
+            const double close_us = std::chrono::duration<double, std::micro>(close_time).count() / ops;
+            printf("Open: %.1f us/device (%.0f opens/s), close: %.1f us/device (%.0f closes/s), %d devices\n",
+                   open_us, 1e6 / open_us, close_us, 1e6 / close_us, scaling_devs_count);
+        }
+
+        _unstub_usb_host();
+        REQUIRE(ESP_OK == test_cdc_acm_host_uninstall());
+    }
+}
+
+SCENARIO("Open all ports of identical multi-port devices")
+{
+    SECTION("Add mocked devices") {
+        usb_host_mock_dev_list_init();
+        for (int addr = 1; addr <= dual_devs_count; addr++) {
+            REQUIRE(ESP_OK == usb_host_mock_add_device(addr, (const usb_device_desc_t *)ftdi_device_desc_fs_hs,
+                                                       (const usb_config_desc_t *)ftdi_config_desc_fs));
+        }
+    }
+
+    GIVEN("Mocked devices are added to the device list") {
+        REQUIRE(ESP_OK == test_cdc_acm_host_install(nullptr));
+        _stub_usb_host();
+
+        cdc_acm_host_device_config_t dev_config = {
+            .connection_timeout_ms = 1,
+            .out_buffer_size = 64,
+            .in_buffer_size = 64,
+            .event_cb = nullptr,
+            .data_cb = nullptr,
+            .user_arg = nullptr,
+            .out_transfer_num = 0,
+            .in_transfer_num = 0,
+            .sibling = nullptr,
+        };
+
+        SECTION("Second port opens on the device of its sibling") {
+            cdc_acm_dev_hdl_t port_a[dual_devs_count];
+            cdc_acm_dev_hdl_t port_b[dual_devs_count];
+
+            // Port A of every device first, so a plain open of port B would pick the first device
+            for (int i = 0; i < dual_devs_count; i++) {
+                REQUIRE(ESP_OK == cdc_acm_host_open(0x0403, 0x6010, 0, &dev_config, &port_a[i]));
+            }
+            for (int i = dual_devs_count - 1; i >= 0; i--) {
+                dev_config.sibling = port_a[i];
+                REQUIRE(ESP_OK == cdc_acm_host_open(0x0403, 0x6010, 1, &dev_config, &port_b[i]));
+                REQUIRE(port_b[i]->dev_hdl == port_a[i]->dev_hdl);
+            }
+
+            // The sibling's port B is taken, the driver doesn't fall back to another device
+            cdc_acm_dev_hdl_t extra = nullptr;
+            dev_config.sibling = port_a[0];
+            REQUIRE(ESP_ERR_NOT_FOUND == cdc_acm_host_open(0x0403, 0x6010, 1, &dev_config, &extra));
+
+            // A closed sibling is rejected
+            REQUIRE(ESP_OK == cdc_acm_host_close(port_b[0]));
+            REQUIRE(ESP_OK == cdc_acm_host_close(port_a[0]));
+            REQUIRE(ESP_ERR_NOT_FOUND == cdc_acm_host_open(0x0403, 0x6010, 1, &dev_config, &extra));
+
+            for (int i = 1; i < dual_devs_count; i++) {
+                REQUIRE(ESP_OK == cdc_acm_host_close(port_b[i]));
+                REQUIRE(ESP_OK == cdc_acm_host_close(port_a[i]));
+            }
+        }
+
+        _unstub_usb_host();
+        REQUIRE(ESP_OK == test_cdc_acm_host_uninstall());
+    }
+}
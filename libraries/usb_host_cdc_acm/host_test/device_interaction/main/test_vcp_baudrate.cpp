@@ -0,0 +1,209 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdio.h>
+#include <algorithm>
+#include <vector>
+#include <catch2/catch_test_macros.hpp>
+
+#include "usb/vcp_baudrate.h"
+
+using namespace esp_usb;
+
+// Divisors are evaluated at compile time
+static_assert(vcp_baud_table<VCP_BAUD_FTDI>.entry[12].baudrate == 115385, "FTDI 115200 is 3 MHz / 26");
+static_assert(vcp_baud_table<VCP_BAUD_FTDI>.entry[12].reg == 26, "FTDI 115200 is 3 MHz / 26");
+static_assert(vcp_baud_table<VCP_BAUD_FTDI>.entry[20].reg == 1, "FTDI 2 Mbaud is divisor 1.5");
+static_assert(vcp_baud_table<VCP_BAUD_FTDI>.entry[21].reg == 0, "FTDI 3 Mbaud is divisor 1");
+static_assert(vcp_baud_table<VCP_BAUD_FTDI_HS>.entry[23].reg == 0x20000, "FTDI 12 Mbaud is divisor 1 of the high-speed clock");
+static_assert(vcp_baud_table<VCP_BAUD_CH34X>.entry[5].reg == 0xB202, "CH34x 9600 is 48 MHz / 64 / 78");
+static_assert(vcp_baud_table<VCP_BAUD_CH34X>.entry[17].reg == 0xF307, "CH34x 921600 is 48 MHz / 4 / 13");
+static_assert(nearest_baud(VCP_BAUD_CP210X, 1000000) == 1000000, "CP210x 1 Mbaud is exact");
+static_assert(nearest_baud(VCP_BAUD_CP210X, 12000000) == 3000000, "CP2102N is clamped to 3 Mbaud");
+static_assert(nearest_baud(VCP_BAUD_CP2104, 3000000) == 2000000, "CP2104 is clamped to 2 Mbaud");
+
+static constexpr uint32_t exhaustive_min = 300;
+static constexpr uint32_t exhaustive_max = 12000000;
+
+/**
+ * @brief All divisors of a clock the chip can use, sorted
+ */
+struct baud_model {
+    uint32_t clock;
+    std::vector<uint32_t> divs;
+};
+
+static baud_model _ftdi_model(uint32_t clock8)
+{
+    baud_model model = {clock8, {8, 12}}; // Divisor 1 and 1.5
+    for (uint32_t div8 = 16; div8 <= VCP_BAUD_FTDI_DIV8_MAX; div8++) {
+        model.divs.push_back(div8);
+    }
+    return model;
+}
+
+static baud_model _ch34x_model(void)
+{
+    baud_model model = {VCP_BAUD_CH34X_CLOCK, {}};
+    for (uint32_t ps = 0; ps <= 3; ps++) {
+        for (uint32_t d = 2; d <= 255; d++) {
+            model.divs.push_back(VCP_BAUD_CH34X_CLK_DIV(ps, 0) * d);
+            if (d >= 9) {
+                model.divs.push_back(VCP_BAUD_CH34X_CLK_DIV(ps, 1) * d);
+            }
+        }
+    }
+    std::sort(model.divs.begin(), model.divs.end());
+    model.divs.erase(std::unique(model.divs.begin(), model.divs.end()), model.divs.end());
+    return model;
+}
+
+static baud_model _cp210x_model(uint32_t prescaler)
+{
+    baud_model model = {VCP_BAUD_CP210X_CLOCK, {}};
+    const uint32_t first = prescaler == 1 ? VCP_BAUD_CP210X_CLOCK / VCP_BAUD_CP210X_MAX : 1;
+    for (uint32_t d = first; d <= VCP_BAUD_CP210X_CLOCK / (prescaler * 300) + 1; d++) {
+        model.divs.push_back(prescaler * d);
+    }
+    return model;
+}
+
+/**
+ * @brief Decode the chip specific divisor into the divisor of the model clock
+ */
+static uint32_t _decode(vcp_baud_family_t family, uint32_t reg)
+{
+    static const uint8_t frac_k[8] = {0, 4, 2, 1, 3, 5, 6, 7}; // bits 14-16 to k/8
+    switch (family) {
+    case VCP_BAUD_FTDI:
+    case VCP_BAUD_FTDI_HS: {
+        reg &= ~0x20000;
+        if (reg == 0) {
+            return 8;
+        } else if (reg == 1) {
+            return 12;
+        }
+        return (reg & 0x3FFF) * 8 + frac_k[reg >> 14];
+    }
+    case VCP_BAUD_CH34X: {
+        if ((reg & ~0xFF07) != 0) {
+            return 0;
+        }
+        return VCP_BAUD_CH34X_CLK_DIV(reg & 0x03, (reg >> 2) & 0x01) * (256 - (reg >> 8));
+    }
+    case VCP_BAUD_CP210X:
+    case VCP_BAUD_CP2104:
+        return reg;
+    default:
+        return 0;
+    }
+}
+
+/**
+ * @brief |clock / div - baudrate| * div
+ */
+static uint64_t _error(uint32_t clock, uint32_t baudrate, uint32_t div)
+{
+    const uint64_t rate = (uint64_t)baudrate * div;
+    return rate > clock ? rate - clock : clock - rate;
+}
+
+/**
+ * @brief True if clock / div_a is as close to baudrate as clock / div_b, or closer
+ */
+static bool _not_worse(uint32_t clock, uint32_t baudrate, uint32_t div_a, uint32_t div_b)
+{
+    return _error(clock, baudrate, div_a) * div_b <= _error(clock, baudrate, div_b) * div_a;
+}
+
+/**
+ * @brief Check one baudrate against the brute force model
+ *
+ * @return true if the divisor is valid, gives the reported rate and no divisor of the model is closer
+ */
+static bool _check(vcp_baud_family_t family, const baud_model &model, uint32_t baudrate)
+{
+    const vcp_baud_divisor_t result = vcp_baud_divisor_get(family, baudrate);
+    const uint32_t div = _decode(family, result.reg);
+    if (div == 0 || !std::binary_search(model.divs.begin(), model.divs.end(), div)) {
+        return false;
+    }
+    if (result.baudrate != (model.clock + div / 2) / div) {
+        return false;
+    }
+
+    // Closest divisors of the model: the last one at or above the baudrate and the first one below
+    const auto above = std::upper_bound(model.divs.begin(), model.divs.end(), model.clock / baudrate);
+    if (above != model.divs.end() && !_not_worse(model.clock, baudrate, div, *above)) {
+        return false;
+    }
+    if (above != model.divs.begin() && !_not_worse(model.clock, baudrate, div, *(above - 1))) {
+        return false;
+    }
+    return true;
+}
+
+SCENARIO("VCP baudrate divisors")
+{
+    SECTION("Standard baudrates are within 3% in the range of each family") {
+        const struct {
+            vcp_baud_family_t family;
+            const vcp_baud_table_t &table;
+            uint32_t max;
+        } families[] = {
+            {VCP_BAUD_FTDI, vcp_baud_table<VCP_BAUD_FTDI>, 3000000},
+            {VCP_BAUD_FTDI_HS, vcp_baud_table<VCP_BAUD_FTDI_HS>, 12000000},
+            {VCP_BAUD_CH34X, vcp_baud_table<VCP_BAUD_CH34X>, VCP_BAUD_CH34X_MAX},
+            {VCP_BAUD_CP210X, vcp_baud_table<VCP_BAUD_CP210X>, VCP_BAUD_CP210X_MAX},
+            {VCP_BAUD_CP2104, vcp_baud_table<VCP_BAUD_CP2104>, VCP_BAUD_CP2104_MAX},
+        };
+        for (const auto &f : families) {
+            for (size_t i = 0; i < vcp_standard_baudrates_num; i++) {
+                const uint32_t requested = vcp_standard_baudrates[i];
+                // Tables are the same as the runtime calculation
+                REQUIRE(f.table.entry[i].baudrate == vcp_baud_divisor_get(f.family, requested).baudrate);
+                REQUIRE(f.table.entry[i].reg == vcp_baud_divisor_get(f.family, requested).reg);
+                if (requested <= f.max) {
+                    const int32_t ppm = vcp_baud_error_ppm(requested, f.table.entry[i].baudrate);
+                    REQUIRE(ppm > -30000);
+                    REQUIRE(ppm < 30000);
+                } else {
+                    REQUIRE(f.table.entry[i].baudrate == f.max);
+                }
+            }
+        }
+    }
+
+    SECTION("Every baudrate from 300 to 12 Mbaud gets the closest divisor") {
+        const baud_model ftdi = _ftdi_model(VCP_BAUD_FTDI_CLOCK8);
+        const baud_model ftdi_hs = _ftdi_model(VCP_BAUD_FTDI_HS_CLOCK8);
+        const baud_model ch34x = _ch34x_model();
+        const baud_model cp210x = _cp210x_model(1);
+        const baud_model cp210x_low = _cp210x_model(4);
+
+        uint32_t first_fail[4] = {};
+        for (uint32_t baudrate = exhaustive_min; baudrate <= exhaustive_max; baudrate++) {
+            if (!first_fail[0] && !_check(VCP_BAUD_FTDI, ftdi, baudrate)) {
+                first_fail[0] = baudrate;
+            }
+            if (!first_fail[1] && !_check(VCP_BAUD_FTDI_HS, baudrate < VCP_BAUD_FTDI_HS_MIN ? ftdi : ftdi_hs, baudrate)) {
+                first_fail[1] = baudrate;
+            }
+            if (!first_fail[2] && !_check(VCP_BAUD_CH34X, ch34x, baudrate)) {
+                first_fail[2] = baudrate;
+            }
+            if (!first_fail[3] && !_check(VCP_BAUD_CP210X, baudrate <= 365 ? cp210x_low : cp210x, baudrate)) {
+                first_fail[3] = baudrate;
+            }
+        }
+        printf("First failing baudrate FTDI: %u, FTDI HS: %u, CH34x: %u, CP210x: %u\n",
+               (unsigned)first_fail[0], (unsigned)first_fail[1], (unsigned)first_fail[2], (unsigned)first_fail[3]);
+        REQUIRE(first_fail[0] == 0);
+        REQUIRE(first_fail[1] == 0);
+        REQUIRE(first_fail[2] == 0);
+        REQUIRE(first_fail[3] == 0);
+    }
+}
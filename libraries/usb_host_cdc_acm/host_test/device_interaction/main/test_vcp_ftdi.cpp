@@ -0,0 +1,166 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdio.h>
+#include <cstring>
+#include <vector>
+#include <catch2/catch_test_macros.hpp>
+
+#include "descriptors/cdc_descriptors.hpp"
+#include "usb/cdc_acm_host.h"
+#include "usb/vcp_ftdi.hpp"
+#include "usb/vcp_baudrate.h"
+#include "mock_add_usb_device.h"
+#include "common_test_fixtures.hpp"
+
+extern "C" {
+#include "Mockusb_host.h"
+}
+
+using namespace esp_usb;
+
+/**
+ * @brief Mocked USB Host stack accepts everything the driver does with an open device
+ */
+static esp_err_t _interface_mock_callback(usb_host_client_handle_t client_hdl, usb_device_handle_t dev_hdl, uint8_t bInterfaceNumber, int call_count)
+{
+    return ESP_OK;
+}
+static esp_err_t _interface_claim_mock_callback(usb_host_client_handle_t client_hdl, usb_device_handle_t dev_hdl, uint8_t bInterfaceNumber, uint8_t bAlternateSetting, int call_count)
+{
+    return ESP_OK;
+}
+static esp_err_t _endpoint_mock_callback(usb_device_handle_t dev_hdl, uint8_t bEndpointAddress, int call_count)
+{
+    return ESP_OK;
+}
+static esp_err_t _transfer_submit_mock_callback(usb_transfer_t *transfer, int call_count)
+{
+    return ESP_OK;
+}
+
+/**
+ * @brief Mocked device accepts every control request, the setup packets are recorded
+ */
+static std::vector<usb_setup_packet_t> ctrl_requests;
+static esp_err_t _ctrl_submit_mock_callback(usb_host_client_handle_t client_hdl, usb_transfer_t *transfer, int call_count)
+{
+    usb_setup_packet_t setup;
+    memcpy(&setup, transfer->data_buffer, sizeof(setup));
+    ctrl_requests.push_back(setup);
+    transfer->status = USB_TRANSFER_STATUS_COMPLETED;
+    transfer->actual_num_bytes = transfer->num_bytes;
+    transfer->callback(transfer);
+    return ESP_OK;
+}
+
+/**
+ * @brief The last SET_BAUDRATE request sent to the device
+ */
+static const usb_setup_packet_t *_last_set_baudrate(void)
+{
+    for (auto it = ctrl_requests.rbegin(); it != ctrl_requests.rend(); ++it) {
+        if (it->bRequest == FTDI_CMD_SET_BAUDRATE) {
+            return &*it;
+        }
+    }
+    return nullptr;
+}
+
+SCENARIO("FTDI baudrate requests")
+{
+    SECTION("Add mocked devices") {
+        usb_host_mock_dev_list_init();
+        REQUIRE(ESP_OK == usb_host_mock_add_device(1, (const usb_device_desc_t *)ft232h_device_desc,
+                                                   (const usb_config_desc_t *)ttl232_config_desc));
+    }
+
+    GIVEN("Mocked FT232H is added to the device list") {
+        REQUIRE(ESP_OK == test_cdc_acm_host_install(nullptr));
+
+        usb_host_device_open_Stub(usb_host_device_open_mock_callback);
+        usb_host_get_device_descriptor_Stub(usb_host_get_device_descriptor_mock_callback);
+        usb_host_device_close_Stub(usb_host_device_close_mock_callback);
+        usb_host_get_active_config_descriptor_Stub(usb_host_get_active_config_descriptor_mock_callback);
+        usb_host_device_addr_list_fill_Stub(usb_host_device_addr_list_fill_mock_callback);
+        usb_host_transfer_alloc_Stub(usb_host_transfer_alloc_mock_callback);
+        usb_host_transfer_free_Stub(usb_host_transfer_free_mock_callback);
+        usb_host_interface_claim_Stub(_interface_claim_mock_callback);
+        usb_host_interface_release_Stub(_interface_mock_callback);
+        usb_host_transfer_submit_Stub(_transfer_submit_mock_callback);
+        usb_host_transfer_submit_control_Stub(_ctrl_submit_mock_callback);
+        usb_host_endpoint_halt_Stub(_endpoint_mock_callback);
+        usb_host_endpoint_flush_Stub(_endpoint_mock_callback);
+        usb_host_endpoint_clear_Stub(_endpoint_mock_callback);
+
+        const cdc_acm_host_device_config_t dev_config = {
+            .connection_timeout_ms = 1,
+            .out_buffer_size = 64,
+            .in_buffer_size = 64,
+            .event_cb = nullptr,
+            .data_cb = nullptr,
+            .user_arg = nullptr,
+        };
+        ctrl_requests.clear();
+        FT23x *ftdi = new FT23x(FT232H_PID, &dev_config, 0);
+
+        cdc_acm_line_coding_t line_coding = {
+            .dwDTERate = 115200,
+            .bCharFormat = 0,
+            .bParityType = 0,
+            .bDataBits = 8,
+        };
+
+        SECTION("The divisor high bits are in the high byte of wIndex, the port in the low byte") {
+            // Opening only resets the port, the line coding is up to the user
+            REQUIRE(_last_set_baudrate() == nullptr);
+
+            REQUIRE(ESP_OK == ftdi->line_coding_set(&line_coding));
+            const usb_setup_packet_t *req = _last_set_baudrate();
+            REQUIRE(req != nullptr);
+            const uint32_t reg_115200 = vcp_baud_divisor_get(VCP_BAUD_FTDI_HS, 115200).reg;
+            REQUIRE(reg_115200 >> 16 == 0x2); // High-speed clock
+            REQUIRE(req->wValue == (reg_115200 & 0xFFFF));
+            REQUIRE(req->wIndex == 0x0200);
+
+            line_coding.dwDTERate = 12000000;
+            REQUIRE(ESP_OK == ftdi->line_coding_set(&line_coding));
+            req = _last_set_baudrate();
+            REQUIRE(req->wValue == 0x0000);
+            REQUIRE(req->wIndex == 0x0200);
+        }
+
+        SECTION("A reopened port keeps its settings") {
+            REQUIRE(ESP_OK == ftdi->line_coding_set(&line_coding));
+            REQUIRE(ESP_OK == ftdi->set_control_line_state(true, false));
+            REQUIRE(ESP_OK == ftdi->set_latency_timer(1));
+            delete ftdi;
+
+            ctrl_requests.clear();
+            ftdi = new FT23x(FT232H_PID, &dev_config, 0);
+            REQUIRE(ESP_OK == ftdi->line_coding_set(&line_coding));
+            REQUIRE(ESP_OK == ftdi->set_control_line_state(true, false));
+            REQUIRE(ESP_OK == ftdi->set_latency_timer(1));
+            REQUIRE(ctrl_requests.empty()); // No reset and no settings sent again
+
+            REQUIRE(ESP_OK == ftdi->set_control_line_state(true, true));
+            REQUIRE(ctrl_requests.size() == 1);
+            REQUIRE(ctrl_requests[0].bRequest == FTDI_CMD_SET_MHS);
+            REQUIRE(ctrl_requests[0].wValue == 0x21); // RTS only
+        }
+
+        delete ftdi;
+
+        usb_host_interface_claim_Stub(nullptr);
+        usb_host_interface_release_Stub(nullptr);
+        usb_host_transfer_submit_Stub(nullptr);
+        usb_host_transfer_submit_control_Stub(nullptr);
+        usb_host_endpoint_halt_Stub(nullptr);
+        usb_host_endpoint_flush_Stub(nullptr);
+        usb_host_endpoint_clear_Stub(nullptr);
+        REQUIRE(ESP_OK == test_cdc_acm_host_uninstall());
+    }
+}
@@ -42,10 +42,30 @@ typedef struct {
  * @param[in] data_len Length of received data in bytes
  * @param[in] user_arg User's argument passed to open function
  * @return true        Received data was processed     -> Flush RX buffer
- * @return false       Received data was NOT processed -> Append new data to the buffer
+ * @return false       Received data was NOT processed -> Append new data to the buffer (only with a single IN transfer)
  */
 typedef bool (*cdc_acm_data_callback_t)(const uint8_t *data, size_t data_len, void *user_arg);
 
+/**
+ * @brief Data transmitted callback type
+ *
+ * @param[in] status   ESP_OK if all data was sent, ESP_ERR_INVALID_RESPONSE if the transfer failed or was canceled
+ * @param[in] data_len Number of bytes that were actually sent
+ * @param[in] user_arg User's argument passed to cdc_acm_host_data_tx_async()
+ */
+typedef void (*cdc_acm_tx_callback_t)(esp_err_t status, size_t data_len, void *user_arg);
+
+/**
+ * @brief Data IN pipe error and recovery statistics
+ */
+typedef struct {
+    uint32_t errors;              /**< Number of bulk IN transfers that failed with STALL, ERROR, TIMED_OUT, OVERFLOW or SKIPPED */
+    uint32_t recoveries;          /**< Number of times polling was restarted after an error */
+    uint32_t recovery_failures;   /**< Number of times recovery gave up after all retries, IN polling stays stopped */
+    uint32_t last_recovery_ms;    /**< Time from the error until polling was restarted, of the last recovery */
+    uint32_t max_recovery_ms;     /**< Longest recovery time */
+} cdc_acm_host_rx_stats_t;
+
 /**
  * @brief Device event callback type
  *
@@ -64,4 +84,9 @@ typedef struct {
     cdc_acm_host_dev_callback_t event_cb; /**< Device's event callback function. Can be NULL */
     cdc_acm_data_callback_t data_cb;      /**< Device's data RX callback function. Can be NULL for write-only devices */
     void *user_arg;                       /**< User's argument that will be passed to the callbacks */
+    uint8_t out_transfer_num;             /**< Number of bulk out transfers that can be in flight at once, each of out_buffer_size. 0 defaults to 1 */
+    uint8_t in_transfer_num;              /**< Number of bulk in transfers queued on the endpoint, each of in_buffer_size. 0 defaults to 1.
+                                               With more than 1, the endpoint stays polled while data_cb runs but data_cb cannot ask to append data */
+    cdc_acm_dev_hdl_t sibling;            /**< Open the interface on the same USB device as this already opened CDC device, sharing its USB device handle.
+                                               NULL opens the first matching USB device */
 } cdc_acm_host_device_config_t;
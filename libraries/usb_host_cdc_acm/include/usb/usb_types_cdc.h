@@ -271,7 +271,8 @@ typedef union {
         uint16_t bFraming : 1;    // A framing error has occurred.
         uint16_t bParity : 1;     // A parity error has occurred.
         uint16_t bOverRun : 1;    // Received data has been discarded due to overrun in the device.
-        uint16_t reserved : 9;
+        uint16_t bCts : 1;        // Not part of CDC-PSTN: state of RS-232 signal CTS, only reported by vendor specific drivers.
+        uint16_t reserved : 8;
     };
     uint16_t val;
 } cdc_acm_uart_state_t;
@@ -0,0 +1,273 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Baudrate divisors of the VCP chips
+ *
+ * Header only and integer math only: the same functions are used by the C drivers at runtime
+ * and evaluated at compile time in C++, where they build the divisor tables of the standard rates.
+ */
+
+#ifdef __cplusplus
+#define VCP_BAUD_FN static constexpr inline
+#else
+#define VCP_BAUD_FN static inline
+#endif
+
+#define VCP_BAUD_FTDI_CLOCK8      (8 * 3000000)  // 3 MHz reference clock, in 1/8 divisor steps
+#define VCP_BAUD_FTDI_HS_CLOCK8   (8 * 12000000) // 12 MHz reference clock of the high-speed chips
+#define VCP_BAUD_FTDI_DIV8_MAX    (16383 * 8 + 7)
+#define VCP_BAUD_FTDI_HS_MIN      (1200)         // High-speed chips use the 3 MHz reference below this rate
+#define VCP_BAUD_CH34X_CLOCK      (48000000)
+#define VCP_BAUD_CH34X_MIN        (46)
+#define VCP_BAUD_CH34X_MAX        (3000000)
+#define VCP_BAUD_CP210X_CLOCK     (24000000)
+#define VCP_BAUD_CP210X_MIN       (300)
+#define VCP_BAUD_CP210X_MAX       (3000000)      // CP2102N
+#define VCP_BAUD_CP2104_MAX       (2000000)      // CP2104, CP2105 interface 0
+
+// CH34x clock divider of a prescaler and clock factor
+#define VCP_BAUD_CH34X_CLK_DIV(ps, fact) (1u << (12 - 3 * (ps) - (fact)))
+
+/**
+ * @brief Baudrate generator families
+ */
+typedef enum {
+    VCP_BAUD_FTDI = 0, /*!< FT232R, FT2232D, FT-X: 3 MHz reference, divisor n + k/8 */
+    VCP_BAUD_FTDI_HS,  /*!< FT2232H, FT4232H, FT232H: 12 MHz reference from 1200 baud, 3 MHz reference below */
+    VCP_BAUD_CH34X,    /*!< CH340, CH341: 48 MHz clock, prescaler and 8 bit divisor */
+    VCP_BAUD_CP210X,   /*!< CP2102N: 24 MHz clock, 16 bit divisor with prescaler 4 up to 365 baud, 300 baud to 3 Mbaud */
+    VCP_BAUD_CP2104,   /*!< CP2104 and CP2105 interface 0: divisor of the CP2102N, up to 2 Mbaud */
+} vcp_baud_family_t;
+
+/*
+ * Other CP210x parts (CP2102, CP2103, CP2105 interface 1, CP2108) pick the baudrate from a fixed table, they are not modelled here.
+ */
+
+/**
+ * @brief Divisor of a baudrate
+ *
+ * The meaning of reg depends on the family:
+ * - FTDI: 18 bit divisor, wValue of FTDI_CMD_SET_BAUDRATE is bits 0-15, wIndex is bits 16-17
+ * - CH34x: (256 - divisor) << 8 | factor << 2 | prescaler, register 0x1312 without the enable bit
+ * - CP2102N, CP2104: total divisor of the 24 MHz clock, the chip takes the baudrate itself
+ */
+typedef struct {
+    uint32_t baudrate; /*!< Achievable baudrate closest to the requested one, rounded */
+    uint32_t reg;      /*!< Chip specific divisor */
+} vcp_baud_divisor_t;
+
+/**
+ * @brief Pick the divisor that gives the closest baudrate
+ *
+ * Exact comparison of clock / div_lo and clock / div_hi with the requested baudrate in between.
+ *
+ * @return true if div_hi is closer
+ */
+VCP_BAUD_FN bool vcp_baud_prefer_hi(uint32_t clock, uint32_t baudrate, uint32_t div_lo, uint32_t div_hi)
+{
+    const uint64_t err_lo = (uint64_t)clock - (uint64_t)baudrate * div_lo;  // Divided by div_lo
+    const uint64_t err_hi = (uint64_t)baudrate * div_hi - clock;            // Divided by div_hi
+    return err_hi * div_lo < err_lo * div_hi;
+}
+
+VCP_BAUD_FN vcp_baud_divisor_t vcp_baud_ftdi(uint32_t clock8, uint32_t baudrate)
+{
+    vcp_baud_divisor_t div = {0, 0};
+    const uint8_t frac_code[8] = {0, 3, 2, 4, 1, 5, 6, 7}; // Sub-integer divisor k/8 to bits 14-16
+    if (baudrate == 0) {
+        return div;
+    }
+
+    uint32_t div8 = clock8 / baudrate;
+    if (div8 < 8) {
+        div8 = 8; // Faster than the reference clock
+    } else if (div8 >= VCP_BAUD_FTDI_DIV8_MAX) {
+        div8 = VCP_BAUD_FTDI_DIV8_MAX;
+    } else if (div8 < 16) {
+        // Only 1 and 1.5 below 2
+        const uint32_t lo = div8 < 12 ? 8 : 12;
+        div8 = vcp_baud_prefer_hi(clock8, baudrate, lo, lo + 4) ? lo + 4 : lo;
+    } else if (vcp_baud_prefer_hi(clock8, baudrate, div8, div8 + 1)) {
+        div8++;
+    }
+
+    if (div8 == 8) {
+        div.reg = 0;
+    } else if (div8 == 12) {
+        div.reg = 1;
+    } else {
+        div.reg = (div8 >> 3) | ((uint32_t)frac_code[div8 & 0x07] << 14);
+    }
+    div.baudrate = (clock8 + div8 / 2) / div8;
+    return div;
+}
+
+VCP_BAUD_FN vcp_baud_divisor_t vcp_baud_ch34x(uint32_t baudrate)
+{
+    vcp_baud_divisor_t div = {0, 0};
+    if (baudrate < VCP_BAUD_CH34X_MIN) {
+        baudrate = VCP_BAUD_CH34X_MIN;
+    } else if (baudrate > VCP_BAUD_CH34X_MAX) {
+        baudrate = VCP_BAUD_CH34X_MAX;
+    }
+
+    // Highest prescaler that keeps the divisor below 512 with factor 1
+    uint32_t ps = 3;
+    while (ps > 0 && (uint64_t)baudrate * VCP_BAUD_CH34X_CLK_DIV(ps, 1) * 512 <= VCP_BAUD_CH34X_CLOCK) {
+        ps--;
+    }
+    uint32_t fact = 1;
+    uint32_t clk_div = VCP_BAUD_CH34X_CLK_DIV(ps, 1);
+    uint32_t d = VCP_BAUD_CH34X_CLOCK / (clk_div * baudrate);
+
+    // Factor 1 only works with divisors from 9 to 255, 8 is kept to choose between 8 and 9 and halved below
+    if (d < 8 || d > 255) {
+        d /= 2;
+        clk_div *= 2;
+        fact = 0;
+    }
+    if (vcp_baud_prefer_hi(VCP_BAUD_CH34X_CLOCK, baudrate, clk_div * d, clk_div * (d + 1))) {
+        d++;
+    }
+    // Even divisors with the halved clock, 921600 only works this way
+    if (fact == 1 && (d % 2) == 0) {
+        d /= 2;
+        clk_div *= 2;
+        fact = 0;
+    }
+    // 256 doesn't fit, same clock divider with the next lower prescaler
+    if (d > 255) {
+        ps--;
+        clk_div *= 8;
+        d = 32;
+    }
+
+    div.reg = ((256 - d) << 8) | (fact << 2) | ps;
+    div.baudrate = (VCP_BAUD_CH34X_CLOCK + clk_div * d / 2) / (clk_div * d);
+    return div;
+}
+
+VCP_BAUD_FN vcp_baud_divisor_t vcp_baud_cp210x(uint32_t baudrate, uint32_t max)
+{
+    vcp_baud_divisor_t div = {0, 0};
+    if (baudrate < VCP_BAUD_CP210X_MIN) {
+        baudrate = VCP_BAUD_CP210X_MIN;
+    } else if (baudrate > max) {
+        baudrate = max;
+    }
+
+    const uint32_t prescaler = baudrate <= 365 ? 4 : 1;
+    uint32_t d = VCP_BAUD_CP210X_CLOCK / (prescaler * baudrate);
+    if (vcp_baud_prefer_hi(VCP_BAUD_CP210X_CLOCK, baudrate, prescaler * d, prescaler * (d + 1))) {
+        d++;
+    }
+
+    div.reg = prescaler * d;
+    div.baudrate = (VCP_BAUD_CP210X_CLOCK + div.reg / 2) / div.reg;
+    return div;
+}
+
+/**
+ * @brief Divisor that gives the baudrate closest to the requested one
+ *
+ * Rates outside of the range of the family are clamped to the range.
+ *
+ * @param[in] family   Baudrate generator family
+ * @param[in] baudrate Requested baudrate
+ * @return Divisor and the achievable baudrate, baudrate 0 for an unknown family or baudrate 0
+ */
+VCP_BAUD_FN vcp_baud_divisor_t vcp_baud_divisor_get(vcp_baud_family_t family, uint32_t baudrate)
+{
+    vcp_baud_divisor_t div = {0, 0};
+    if (baudrate == 0) {
+        return div;
+    }
+    switch (family) {
+    case VCP_BAUD_FTDI:
+        div = vcp_baud_ftdi(VCP_BAUD_FTDI_CLOCK8, baudrate);
+        break;
+    case VCP_BAUD_FTDI_HS:
+        if (baudrate < VCP_BAUD_FTDI_HS_MIN) {
+            div = vcp_baud_ftdi(VCP_BAUD_FTDI_CLOCK8, baudrate);
+        } else {
+            div = vcp_baud_ftdi(VCP_BAUD_FTDI_HS_CLOCK8, baudrate);
+            div.reg |= 0x20000; // High-speed clock: no divide by 2.5
+        }
+        break;
+    case VCP_BAUD_CH34X:
+        div = vcp_baud_ch34x(baudrate);
+        break;
+    case VCP_BAUD_CP210X:
+        div = vcp_baud_cp210x(baudrate, VCP_BAUD_CP210X_MAX);
+        break;
+    case VCP_BAUD_CP2104:
+        div = vcp_baud_cp210x(baudrate, VCP_BAUD_CP2104_MAX);
+        break;
+    default:
+        break;
+    }
+    return div;
+}
+
+/**
+ * @brief Error of an achievable baudrate
+ *
+ * @return Error in parts per million, positive if the achievable rate is faster
+ */
+VCP_BAUD_FN int32_t vcp_baud_error_ppm(uint32_t requested, uint32_t achieved)
+{
+    return requested == 0 ? 0 : (int32_t)(((int64_t)achieved - (int64_t)requested) * 1000000 / (int64_t)requested);
+}
+
+#ifdef __cplusplus
+#include <cstddef>
+
+namespace esp_usb {
+
+// Standard baudrates of the constexpr divisor tables
+constexpr uint32_t vcp_standard_baudrates[] = {
+    300, 600, 1200, 2400, 4800, 9600, 14400, 19200, 28800, 38400, 57600, 76800, 115200, 230400,
+    250000, 460800, 500000, 921600, 1000000, 1500000, 2000000, 3000000, 6000000, 12000000
+};
+constexpr size_t vcp_standard_baudrates_num = sizeof(vcp_standard_baudrates) / sizeof(vcp_standard_baudrates[0]);
+
+struct vcp_baud_table_t {
+    vcp_baud_divisor_t entry[vcp_standard_baudrates_num]; // Same order as vcp_standard_baudrates
+};
+
+constexpr vcp_baud_table_t vcp_baud_table_make(vcp_baud_family_t family)
+{
+    vcp_baud_table_t table = {};
+    for (size_t i = 0; i < vcp_standard_baudrates_num; i++) {
+        table.entry[i] = vcp_baud_divisor_get(family, vcp_standard_baudrates[i]);
+    }
+    return table;
+}
+
+// Divisors of the standard baudrates, evaluated at compile time
+template <vcp_baud_family_t family>
+constexpr vcp_baud_table_t vcp_baud_table = vcp_baud_table_make(family);
+
+/**
+ * @brief Achievable baudrate closest to the requested one
+ *
+ * @param[in] family   Baudrate generator family
+ * @param[in] baudrate Requested baudrate
+ * @return Baudrate the chip actually runs at
+ */
+constexpr uint32_t nearest_baud(vcp_baud_family_t family, uint32_t baudrate)
+{
+    return vcp_baud_divisor_get(family, baudrate).baudrate;
+}
+
+} // esp_usb
+#endif
@@ -13,6 +13,10 @@
 #define CH340_PID                  (0x7522)
 #define CH340_PID_1                (0x7523)
 #define CH341_PID                  (0x5523)
+#define CH342_PID                  (0x55D2) // Dual port
+#define CH343_PID                  (0x55D3)
+#define CH9102_PID                 (0x55D4)
+#define CH344_PID                  (0x55D5) // Quad port
 
 // Auto detect supported PIDs
 #define CH34X_PID_AUTO             (0)
@@ -24,8 +28,11 @@ extern "C" {
 /**
  * @brief Open CH34x device
  *
+ * CH342, CH343, CH344 and CH9102 are CDC-ACM compliant: they use the CDC-ACM requests and derive the baudrate divisor themselves,
+ * which allows rates above the 3 MBaud of CH340 and CH341. Port n of the multi-port parts is the interface pair 2n and 2n + 1.
+ *
  * @param[in]  pid           PID of the device
- * @param[in]  interface_idx Interface number
+ * @param[in]  interface_idx Port number, 0 on single port chips
  * @param[in]  dev_config    CDC device configuration
  * @param[out] cdc_hdl_ret   Pointer to the CDC handle
  * @return
@@ -27,7 +27,7 @@ public:
      *
      * @param[in] pid            PID eg. CH340_PID
      * @param[in] dev_config     CDC device configuration
-     * @param[in] interface_idx  Interface number
+     * @param[in] interface_idx  Port number, 0 on single port chips
      * @return CdcAcmDevice      Pointer to created and opened CH34x device
      */
     CH34x(uint16_t pid, const cdc_acm_host_device_config_t *dev_config, uint8_t interface_idx = 0)
@@ -40,7 +40,7 @@ public:
 
     // List of supported VIDs and PIDs
     static constexpr uint16_t vid = NANJING_QINHENG_MICROE_VID;
-    static constexpr std::array<uint16_t, 3> pids = {CH340_PID, CH340_PID_1, CH341_PID};
+    static constexpr std::array<uint16_t, 7> pids = {CH340_PID, CH340_PID_1, CH341_PID, CH342_PID, CH343_PID, CH9102_PID, CH344_PID};
 
 private:
     // Make open functions from CdcAcmDevice class private
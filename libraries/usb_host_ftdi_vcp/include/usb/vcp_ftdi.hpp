@@ -14,6 +14,9 @@
 #define FTDI_VID             (0x0403)
 #define FT232_PID            (0x6001)
 #define FT231_PID            (0x6015)
+#define FT2232_PID           (0x6010) // Dual port, interface 0 and 1. FT2232D and FT2232H
+#define FT4232H_PID          (0x6011) // Quad port, interface 0 - 3
+#define FT232H_PID           (0x6014)
 
 #define FTDI_CMD_RESET        (0x00)
 #define FTDI_CMD_SET_FLOW     (0x01)
@@ -21,6 +24,10 @@
 #define FTDI_CMD_SET_BAUDRATE (0x03)
 #define FTDI_CMD_SET_LINE_CTL (0x04)
 #define FTDI_CMD_GET_MDMSTS   (0x05) // Modem status
+#define FTDI_CMD_SET_EVENT_CHAR     (0x06)
+#define FTDI_CMD_SET_LATENCY_TIMER  (0x09)
+
+#define FTDI_LATENCY_DEFAULT_MS (16)
 
 namespace esp_usb {
 class FT23x : public CdcAcmDevice {
@@ -29,10 +36,12 @@ public:
      * @brief Constructor for this FTDI driver
      *
      * @note USB Host library and CDC-ACM driver must be already installed
+     * @note The port is reset only when the driver knows nothing of its settings, eg. on the first open after it was connected.
+     *       Reopening keeps the port's settings. Set the line coding after opening.
      *
      * @param[in] pid            PID eg. FTDI_FT232_PID
      * @param[in] dev_config     CDC device configuration
-     * @param[in] interface_idx  Interface number
+     * @param[in] interface_idx  Interface number, selects the port on multi-port chips
      * @return CdcAcmDevice      Pointer to created and opened FTDI device
      */
     FT23x(uint16_t pid, const cdc_acm_host_device_config_t *dev_config, uint8_t interface_idx = 0);
@@ -40,6 +49,8 @@ public:
     /**
      * @brief Set Line Coding method
      *
+     * Only the requests for the parts that differ from the port's current line coding are sent.
+     *
      * @note Overrides default implementation in CDC-ACM driver
      * @param[in] line_coding Line Coding structure
      * @return esp_err_t
@@ -51,27 +62,72 @@ public:
      *
      * @note Overrides default implementation in CDC-ACM driver
      * @note Both signals are active low
+     * @note Only the signals that change are sent to the device
      * @param[in] dtr Indicates to DCE if DTE is present or not. This signal corresponds to V.24 signal 108/2 and RS-232 signal Data Terminal Ready.
      * @param[in] rts Carrier control for half duplex modems. This signal corresponds to V.24 signal 105 and RS-232 signal Request To Send.
      * @return esp_err_t
      */
     esp_err_t set_control_line_state(bool dtr, bool rts);
 
+    /**
+     * @brief Set the latency timer
+     *
+     * The chip sends a partially filled packet when no more data arrived for this time.
+     * Lower values cut the RX latency of short messages, at the cost of more, smaller USB packets.
+     *
+     * @note Only sent to the device when it changes
+     * @param[in] latency_ms Latency in [ms], 1 - 255. Power-on default is FTDI_LATENCY_DEFAULT_MS
+     * @return esp_err_t
+     */
+    esp_err_t set_latency_timer(uint8_t latency_ms);
+
+    /**
+     * @brief Set the event character
+     *
+     * When the event character is received, the chip sends the pending RX data right away, without waiting for the latency timer.
+     * Use it with protocols whose messages end on a known character, eg. '\n'.
+     *
+     * @note Only sent to the device when it changes
+     * @param[in] event_char Event character
+     * @param[in] enable     Enable or disable the event character
+     * @return esp_err_t
+     */
+    esp_err_t set_event_char(uint8_t event_char, bool enable = true);
+
     // List of supported VIDs and PIDs
     static constexpr uint16_t vid = FTDI_VID;
-    static constexpr std::array<uint16_t, 2> pids = {FT232_PID, FT231_PID};
+    static constexpr std::array<uint16_t, 5> pids = {FT232_PID, FT231_PID, FT2232_PID, FT4232H_PID, FT232H_PID};
 
 private:
     const uint8_t intf;
+    const bool multi_port; // Requests address the port as intf + 1
+    bool hs_clock;         // High-speed chip (FT2232H, FT4232H, FT232H) with 120 MHz baudrate clock
+    bool hx_series;        // FT2232, FT4232H, FT232H and FT-X: baudrate divisor bits 16+ in the high byte of wIndex, port in the low byte
     const cdc_acm_data_callback_t user_data_cb;
     const cdc_acm_host_dev_callback_t user_event_cb;
     void *user_arg;
     uint16_t uart_state;
+    uint16_t in_mps;               // Every IN packet of this size starts with the status bytes
+
+    /**
+     * @brief Send a vendor setting unless the port is known to have it already
+     *
+     * The current settings of the port are kept by the CDC-ACM driver with the interface's line state,
+     * so they survive closing and reopening the port.
+     *
+     * @param[in] idx     Index of the setting in the line state
+     * @param[in] request FTDI request
+     * @param[in] wValue  Value of the setting
+     * @return esp_err_t
+     */
+    esp_err_t vendor_setting_set(uint8_t idx, uint8_t request, uint16_t wValue);
 
     /**
      * @brief FT23x's RX data handler
      *
-     * First two bytes are status bytes, the RX data start at data[2].
+     * Every USB packet starts with two status bytes, followed by the RX data.
+     * An IN transfer can hold several packets: the status bytes of all packets are stripped in place, in one pass,
+     * so the user gets the RX data without gaps. Modem status is taken from the last packet, line errors from any packet.
      * Coding of status bytes:
      * Byte 0:
      *      Bit 0: Full Speed packet
@@ -99,29 +155,11 @@ private:
     // Just a wrapper to recover user's argument
     static void ftdi_event(const cdc_acm_host_dev_event_data_t *event, void *user_ctx);
 
-    /**
-     * @brief Construct a new calculate baudrate object
-     *
-     * A Baud rate for the FT232R, FT2232 (UART mode) or FT232B is generated using the chips
-     * internal 48MHz clock. This is input to Baud rate generator circuitry where it is then divided by 16
-     * and fed into a prescaler as a 3MHz reference clock. This 3MHz reference clock is then divided
-     * down to provide the required Baud rate for the device's on chip UART. The value of the Baud rate
-     * divisor is an integer plus a sub-integer prescaler.
-     * Allowed values for the Baud rate divisor are:
-     * Divisor = n + 0, 0.125, 0.25, 0.375, 0.5, 0.625, 0.75, 0.875; where n is an integer between 2 and
-     * 16384 (214).
-     *
-     * Note: Divisor = 1 and Divisor = 0 are special cases. A divisor of 0 will give 3 MBaud, and a divisor
-     * of 1 will give 2 MBaud. Sub-integer divisors between 0 and 2 are not allowed.
-     * Therefore the value of the divisor needed for a given Baud rate is found by dividing 3000000 by the
-     * required Baud rate.
-     *
-     * @see FTDI AN232B-05 Configuring FT232R, FT2232 and FT232B Baud Rates
-     * @param[in]  baudrate
-     * @param[out] wValue
-     * @param[out] wIndex
-     */
-    static int calculate_baudrate(uint32_t baudrate, uint16_t *wValue, uint16_t *wIndex);
+    // wIndex of port specific requests
+    inline uint16_t port() const
+    {
+        return this->multi_port ? this->intf + 1 : this->intf;
+    }
 
     // Make open functions from CdcAcmDevice class private
     using CdcAcmDevice::open;
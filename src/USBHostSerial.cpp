@@ -14,34 +14,71 @@ SPDX-License-Identifier: CC0-1.0
 
 using namespace esp_usb;
 
-USBHostSerial::USBHostSerial(uint16_t vid, uint16_t pid)
-: _host_config{}
-, _line_coding{}
-, _tx_buf_mem{}
-, _tx_buf_handle(nullptr)
-, _tx_buf_data{}
-, _rx_buf_mem{}
-, _rx_buf_handle(nullptr)
-, _rx_buf_data{}
+// notification bits to wake the TX task
+static constexpr uint32_t USBHOSTSERIAL_TX_DATA = 1 << 0;
+static constexpr uint32_t USBHOSTSERIAL_TX_DISCONNECTED = 1 << 1;
+static constexpr uint32_t USBHOSTSERIAL_TX_NEW_DEV = 1 << 2;
+static constexpr uint32_t USBHOSTSERIAL_TX_SETTINGS = 1 << 3;
+static constexpr uint32_t USBHOSTSERIAL_TX_END = 1 << 4;
+
+// TX error handling
+// a send is at most one OUT packet: a timed out transfer is flushed between its packets, so retrying a longer one could repeat bytes
+static constexpr std::size_t USBHOSTSERIAL_TX_CHUNK = USBHOSTSERIAL_BUFFERSIZE / 2;  // upper bound, capped at the OUT packet size
+static constexpr std::size_t USBHOSTSERIAL_TX_MIN_CHUNK = 16;
+static constexpr uint32_t USBHOSTSERIAL_TX_BACKOFF_MAX = 64;       // ms, longest pause between retries
+static constexpr uint32_t USBHOSTSERIAL_TX_REQUEUE_DELAY = 100;    // ms, pause before requeued data is retried
+
+USBHostSerial::USBHostSerial(uint16_t vid, uint16_t pid, uint8_t interface)
+: _line_coding{}
+, _tx_buf()
+, _rx_buf()
+, _tx_lent(0)
+, _rx_dropped(0)
+, _rx_last(0)
+, _rx_idle_gap(0)
+, _overflow_policy(USBHostSerialOverflow::DROP_NEWEST)
+, _tx_policy(USBHostSerialTxPolicy::REQUEUE)
+, _tx_retries(3)
+, _tx_stats{}
 , _setupDone(false)
 , _fallback(false)
 , _vid(vid)
 , _pid(pid)
+, _interface(interface)
+, _dtr(false)
+, _rts(false)
+, _control_lines_set(false)
+, _latency(0)
+, _event_char(-1)
+, _last_dev{}
 , _device_disconnected_sem(nullptr)
-, _usb_lib_task_handle(nullptr)
+, _task_stopped_sem(nullptr)
+, _rx_held_mux(nullptr)
+, _device(nullptr)
+, _cdc_hdl(nullptr)
+, _serial_state(0)
+, _rx_held_data(nullptr)
+, _rx_held_len(0)
+, _rx_waiter(nullptr)
+, _rx_wait_min(0)
+, _USBHostSerial_task_handle(nullptr)
+, _first_port(nullptr)
+, _next_port(nullptr)
 , _logger(nullptr) {
-  _tx_buf_handle = xRingbufferCreateStatic(USBHOSTSERIAL_BUFFERSIZE, RINGBUF_TYPE_BYTEBUF, _tx_buf_mem, &_tx_buf_data);
-  _rx_buf_handle = xRingbufferCreateStatic(USBHOSTSERIAL_BUFFERSIZE, RINGBUF_TYPE_BYTEBUF, _rx_buf_mem, &_rx_buf_data);
-  if (!_tx_buf_handle || !_rx_buf_handle) {
-    abort();
-  }
+  setRxIdleGap(USBHOSTSERIAL_RX_IDLE_GAP);
 }
 
 USBHostSerial::~USBHostSerial() {
-  // TODO (bertmelis): implement destruction.
-  vRingbufferDelete(_tx_buf_handle);
-  vRingbufferDelete(_rx_buf_handle);
-  abort();
+  end();
+  if (_device_disconnected_sem) {
+    vSemaphoreDelete(_device_disconnected_sem);
+  }
+  if (_task_stopped_sem) {
+    vSemaphoreDelete(_task_stopped_sem);
+  }
+  if (_rx_held_mux) {
+    vSemaphoreDelete(_rx_held_mux);
+  }
 }
 
 USBHostSerial::operator bool() const {
@@ -54,8 +91,12 @@ USBHostSerial::operator bool() const {
 
 bool USBHostSerial::begin(int baud, int stopbits, int parity, int databits) {
   if (!_setupDone) {
-    _setupDone = true;
     _setup();
+    _setupDone = USBHostSerialManager::attach(this);
+    if (!_setupDone) {
+      _log("USB setup failed");
+      return false;
+    }
   }
 
   _line_coding.dwDTERate = baud;
@@ -63,6 +104,12 @@ bool USBHostSerial::begin(int baud, int stopbits, int parity, int databits) {
   _line_coding.bParityType = parity;
   _line_coding.bDataBits = databits;
 
+  // already running: only apply the new line coding
+  if (_USBHostSerial_task_handle) {
+    _notify_tx(USBHOSTSERIAL_TX_SETTINGS);
+    return true;
+  }
+
   if (xTaskCreate(_USBHostSerial_task, "usb_dev_lib", 4096, this, 1, &_USBHostSerial_task_handle) == pdTRUE) {
     _log("USB setup done");
     return true;
@@ -72,63 +119,202 @@ bool USBHostSerial::begin(int baud, int stopbits, int parity, int databits) {
 }
 
 void USBHostSerial::end() {
-  // TODO (bertmelis): implement end, together with destruction.
+  if (!_setupDone) {
+    return;
+  }
+
+  // the task closes the device and then waits to be deleted
+  if (_USBHostSerial_task_handle) {
+    xTaskNotify(_USBHostSerial_task_handle, USBHOSTSERIAL_TX_END, eSetBits);
+    xSemaphoreTake(_task_stopped_sem, portMAX_DELAY);
+  }
+
+  // no new device notifications from here on: nothing wakes the task anymore
+  USBHostSerialManager::detach(this);
+  if (_USBHostSerial_task_handle) {
+    vTaskDelete(_USBHostSerial_task_handle);
+    _USBHostSerial_task_handle = nullptr;
+  }
+  _setupDone = false;
+  _log("USB ended");
 }
 
 std::size_t USBHostSerial::write(uint8_t data) {
-  if (xRingbufferSend(_tx_buf_handle, &data, 1, pdMS_TO_TICKS(1)) == pdTRUE) {
-    return 1;
-  }
-  return 0;
+  std::size_t retVal = _tx_buf.write(&data, 1);
+  _notify_tx(USBHOSTSERIAL_TX_DATA);
+  return retVal;
 }
 
 std::size_t USBHostSerial::write(const uint8_t *data, std::size_t len) {
-  UBaseType_t numItemsWaiting;
-  vRingbufferGetInfo(_tx_buf_handle, nullptr, nullptr, nullptr, nullptr, &numItemsWaiting);
-  std::size_t maxSize = USBHOSTSERIAL_BUFFERSIZE - numItemsWaiting;
+  std::size_t maxSize = _tx_buf.space();
   if (maxSize < len) {
     char buf[40];
     snprintf(buf, 40, "USB buf overflow: %u-%u", len, maxSize);
     _log(buf);
-  } else {
-    if (xRingbufferSend(_tx_buf_handle, data, len, pdMS_TO_TICKS(1)) == pdTRUE) {
-      return len;
-    }
+    return 0;
   }
-  return 0;
+  std::size_t retVal = _tx_buf.write(data, len);
+  _notify_tx(USBHOSTSERIAL_TX_DATA);
+  return retVal;
+}
+
+std::size_t USBHostSerial::beginWrite(uint8_t **data) {
+  _tx_lent = _tx_buf.writeSpan(data);
+  return _tx_lent;
+}
+
+void USBHostSerial::commitWrite(std::size_t len) {
+  // only the block lent by beginWrite() was written: free space after a wrap-around wasn't
+  if (len > _tx_lent) {
+    len = _tx_lent;
+  }
+  _tx_lent = 0;
+  _tx_buf.commit(len);
+  _notify_tx(USBHOSTSERIAL_TX_DATA);
 }
 
 std::size_t USBHostSerial::available() {
-  UBaseType_t numItemsWaiting;
-  vRingbufferGetInfo(_rx_buf_handle, nullptr, nullptr, nullptr, nullptr, &numItemsWaiting);
-  return numItemsWaiting;
+  _rx_release_held();
+  return _rx_buf.size();
 }
 
 uint8_t USBHostSerial::read() {
-  std::size_t pxItemSize = 0;
   uint8_t retVal = 0;
-  void* ret = xRingbufferReceiveUpTo(_rx_buf_handle, &pxItemSize, pdMS_TO_TICKS(1), 1);
-  if (pxItemSize > 0) {
-    retVal = *reinterpret_cast<uint8_t*>(ret);
-    vRingbufferReturnItem(_rx_buf_handle, ret);
-  }
+  _rx_buf.read(&retVal, 1);
+  _rx_release_held();
   return retVal;
 }
 
 std::size_t USBHostSerial::read(uint8_t *dest, std::size_t size) {
-  std::size_t retVal = 0;
-  std::size_t pxItemSize = 0;
-  while (size > pxItemSize) {
-    void *ret = xRingbufferReceiveUpTo(_rx_buf_handle, &pxItemSize, pdMS_TO_TICKS(1), size - pxItemSize);
-    if (ret) {
-      std::memcpy(dest, ret, pxItemSize);
-      retVal += pxItemSize;
-      vRingbufferReturnItem(_rx_buf_handle, ret);
-    } else {
+  std::size_t retVal = _rx_buf.read(dest, size);
+  _rx_release_held();
+  return retVal;
+}
+
+std::size_t USBHostSerial::read(uint8_t *dest, std::size_t size, uint32_t timeout) {
+  waitForData(size, timeout);
+  return read(dest, size);
+}
+
+std::size_t USBHostSerial::waitForData(std::size_t minBytes, uint32_t timeout) {
+  if (minBytes > _rx_buf.capacity()) {
+    minBytes = _rx_buf.capacity();
+  }
+  const TickType_t gap = _rx_idle_gap;
+  TickType_t ticksToWait = pdMS_TO_TICKS(timeout);
+  TimeOut_t timeOut;
+  vTaskSetTimeOutState(&timeOut);
+  std::size_t avail = available();
+  while (avail < minBytes) {
+    // register as waiter, then check again so data that arrived in between isn't missed
+    ulTaskNotifyValueClearIndexed(nullptr, USBHOSTSERIAL_RX_NOTIFY_INDEX, UINT32_MAX);
+    _rx_wait_min.store(minBytes, std::memory_order_relaxed);
+    _rx_waiter.store(xTaskGetCurrentTaskHandle(), std::memory_order_release);
+    avail = available();
+    if (avail >= minBytes || xTaskCheckForTimeOut(&timeOut, &ticksToWait) == pdTRUE) {
       break;
     }
+    TickType_t sleep = ticksToWait;
+    if (avail > 0 && gap > 0) {
+      // data pending: return it once nothing was received for more than the gap
+      // _rx_last is stored before the data, the load of `avail` makes it visible
+      const TickType_t silent = xTaskGetTickCount() - _rx_last.load(std::memory_order_relaxed);
+      if (silent > gap) {
+        break;
+      }
+      if (gap + 1 - silent < sleep) {
+        sleep = gap + 1 - silent;
+      }
+    }
+    ulTaskNotifyTakeIndexed(USBHOSTSERIAL_RX_NOTIFY_INDEX, pdTRUE, sleep);
+    _rx_waiter.store(nullptr, std::memory_order_release);
+    avail = available();
   }
-  return retVal;
+  _rx_waiter.store(nullptr, std::memory_order_release);
+  return avail;
+}
+
+void USBHostSerial::setRxIdleGap(uint32_t gapMs) {
+  TickType_t gap = pdMS_TO_TICKS(gapMs);
+  if (gapMs > 0 && pdTICKS_TO_MS(gap) < gapMs) {
+    ++gap;
+  }
+  _rx_idle_gap = gap;
+}
+
+std::size_t USBHostSerial::readSpan(const uint8_t **data) {
+  _rx_release_held();
+  return _rx_buf.readSpan(data);
+}
+
+bool USBHostSerial::consume(std::size_t len) {
+  const bool intact = _rx_buf.consume(len);
+  _rx_release_held();
+  return intact;
+}
+
+std::size_t USBHostSerial::rxDropped() const {
+  return _rx_dropped.load(std::memory_order_relaxed);
+}
+
+void USBHostSerial::setOverflowPolicy(USBHostSerialOverflow policy) {
+  _overflow_policy = policy;
+}
+
+void USBHostSerial::setTxErrorPolicy(USBHostSerialTxPolicy policy, uint8_t retries) {
+  _tx_policy = policy;
+  _tx_retries = retries;
+}
+
+USBHostSerialTxStats USBHostSerial::txStats() const {
+  USBHostSerialTxStats stats;
+  stats.timeouts = _tx_stats.timeouts.load(std::memory_order_relaxed);
+  stats.failures = _tx_stats.failures.load(std::memory_order_relaxed);
+  stats.otherErrors = _tx_stats.otherErrors.load(std::memory_order_relaxed);
+  stats.retries = _tx_stats.retries.load(std::memory_order_relaxed);
+  stats.discarded = _tx_stats.discarded.load(std::memory_order_relaxed);
+  return stats;
+}
+
+void USBHostSerial::setControlLines(bool dtr, bool rts) {
+  _dtr = dtr;
+  _rts = rts;
+  _control_lines_set = true;
+  _notify_tx(USBHOSTSERIAL_TX_SETTINGS);
+}
+
+bool USBHostSerial::cts() const {
+  cdc_acm_uart_state_t state;
+  state.val = _serial_state.load(std::memory_order_relaxed);
+  return state.bCts;
+}
+
+bool USBHostSerial::dsr() const {
+  cdc_acm_uart_state_t state;
+  state.val = _serial_state.load(std::memory_order_relaxed);
+  return state.bTxCarrier;
+}
+
+bool USBHostSerial::dcd() const {
+  cdc_acm_uart_state_t state;
+  state.val = _serial_state.load(std::memory_order_relaxed);
+  return state.bRxCarrier;
+}
+
+bool USBHostSerial::ri() const {
+  cdc_acm_uart_state_t state;
+  state.val = _serial_state.load(std::memory_order_relaxed);
+  return state.bRingSignal;
+}
+
+void USBHostSerial::setLatencyTimer(uint8_t latencyMs) {
+  _latency = latencyMs;
+  _notify_tx(USBHOSTSERIAL_TX_SETTINGS);
+}
+
+void USBHostSerial::setEventChar(uint8_t eventChar, bool enable) {
+  _event_char = eventChar | (enable ? 0x100 : 0);
+  _notify_tx(USBHOSTSERIAL_TX_SETTINGS);
 }
 
 void USBHostSerial::setLogger(USBHostSerialLoggerFunc logger) {
@@ -136,125 +322,425 @@ void USBHostSerial::setLogger(USBHostSerialLoggerFunc logger) {
 }
 
 void USBHostSerial::_setup() {
-  _device_disconnected_sem = xSemaphoreCreateBinary();
-  assert(_device_disconnected_sem);
-  xSemaphoreGive(_device_disconnected_sem);  // make available for first use
+  if (!_device_disconnected_sem) {
+    _device_disconnected_sem = xSemaphoreCreateBinary();
+    assert(_device_disconnected_sem);
+    xSemaphoreGive(_device_disconnected_sem);  // make available for first use
+  }
+
+  if (!_task_stopped_sem) {
+    _task_stopped_sem = xSemaphoreCreateBinary();
+    assert(_task_stopped_sem);
+  }
+
+  if (!_rx_held_mux) {
+    _rx_held_mux = xSemaphoreCreateMutex();
+    assert(_rx_held_mux);
+  }
+}
 
-  // Install USB Host driver. Should only be called once in entire application
-  _host_config.skip_phy_setup = false;
-  _host_config.intr_flags = ESP_INTR_FLAG_LEVEL1;
-  ESP_ERROR_CHECK(usb_host_install(&_host_config));
+CdcAcmDevice *USBHostSerial::_open(const cdc_acm_host_device_config_t *dev_config) {
+  // the other ports of a multi-port device wait until the first port is open
+  if (_first_port && !dev_config->sibling) {
+    return nullptr;
+  }
 
-  // Create a task that will handle USB library events
-  BaseType_t task_created = xTaskCreate(_usb_lib_task, "usb_lib", 4096, this, 1, &_usb_lib_task_handle);
-  assert(task_created == pdTRUE);
+  // reconnect: open the last device the same way, without trying other drivers first
+  CdcAcmDevice *device = nullptr;
+  if (_last_dev.valid) {
+    device = _open_as(_last_dev.vid, _last_dev.pid, _last_dev.fallback, dev_config);
+    if (device) {
+      return device;
+    }
+  }
 
-  ESP_ERROR_CHECK(cdc_acm_host_install(NULL));
+  // VCP drivers are matched on an exact VID and PID, or any supported device
+  const bool anyVid = _vid == CDC_HOST_ANY_VID;
+  const bool anyPid = _pid == CDC_HOST_ANY_PID;
+  if (anyVid && anyPid) {
+    device = VCP::open(dev_config, _interface);
+  } else if (!anyVid && !anyPid) {
+    device = VCP::open(_vid, _pid, dev_config, _interface);
+  }
+  if (device) {
+    _fallback = false;
+    return device;
+  }
 
-  // Register VCP drivers to VCP service
-  VCP::register_driver<FT23x>();
-  VCP::register_driver<CP210x>();
-  VCP::register_driver<CH34x>();
+  // try to fallback to CDC
+  return _open_as(_vid, _pid, true, dev_config);
+}
+
+CdcAcmDevice *USBHostSerial::_open_as(uint16_t vid, uint16_t pid, bool fallback, const cdc_acm_host_device_config_t *dev_config) {
+  CdcAcmDevice *device = nullptr;
+  if (fallback) {
+    device = new CdcAcmDevice();
+    if (device->open(vid, pid, _interface, dev_config) != ESP_OK) {
+      delete device;
+      device = nullptr;
+    }
+  } else {
+    device = VCP::open(vid, pid, dev_config, _interface);
+  }
+  if (device) {
+    _fallback = fallback;
+  }
+  return device;
+}
+
+void USBHostSerial::_remember(CdcAcmDevice *device) {
+  const usb_device_desc_t *device_desc = nullptr;
+  usb_device_info_t dev_info = {};
+  if (device->device_info(&device_desc, &dev_info) != ESP_OK) {
+    _last_dev.valid = false;
+    return;
+  }
+
+  // FNV-1a over the serial number string
+  uint32_t serial = 0;
+  const usb_str_desc_t *str = dev_info.str_desc_serial_num;
+  if (str && str->bLength >= 2) {
+    serial = 2166136261u;
+    for (std::size_t i = 0; i < (str->bLength - 2u) / 2u; ++i) {
+      serial = (serial ^ str->wData[i]) * 16777619u;
+    }
+  }
+
+  if (_last_dev.valid && _last_dev.vid == device_desc->idVendor && _last_dev.pid == device_desc->idProduct &&
+      _last_dev.serial == serial && _last_dev.fallback == _fallback) {
+    _log("USB device reconnected");
+    return;
+  }
+  _last_dev.valid = true;
+  _last_dev.vid = device_desc->idVendor;
+  _last_dev.pid = device_desc->idProduct;
+  _last_dev.serial = serial;
+  _last_dev.fallback = _fallback;
+  _last_dev.noLineCoding = false;
+  _last_dev.noControlLines = false;
+}
+
+esp_err_t USBHostSerial::_restore(CdcAcmDevice *device) {
+  // the drivers only send the requests for what differs from the device's current state
+  esp_err_t err = ESP_OK;
+  if (!_last_dev.noLineCoding) {
+    err = device->line_coding_set(&_line_coding);
+    if (err == ESP_ERR_NOT_SUPPORTED && _fallback) {
+      // a plain CDC device doesn't have to support line coding, eg. a device with fixed UART settings
+      _last_dev.noLineCoding = true;
+      err = ESP_OK;
+    }
+    if (err != ESP_OK) {
+      return err;
+    }
+  }
+  if (_control_lines_set && !_last_dev.noControlLines) {
+    // only a stalled request means the device can't do it, other errors are tried again after the next reconnect
+    err = device->set_control_line_state(_dtr, _rts);
+    if (err == ESP_ERR_NOT_SUPPORTED) {
+      _last_dev.noControlLines = true;
+      _log("USB control lines not supported");
+    } else if (err != ESP_OK) {
+      _log("USB control lines not set");
+    }
+  }
+
+  // only FT23x is registered for the FTDI VID
+  if (!_fallback && _last_dev.valid && _last_dev.vid == FTDI_VID) {
+    FT23x *ftdi = static_cast<FT23x*>(device);
+    if (_latency != 0 && ftdi->set_latency_timer(_latency) != ESP_OK) {
+      _log("USB latency timer not set");
+    }
+    const int16_t eventChar = _event_char;
+    if (eventChar >= 0 && ftdi->set_event_char(eventChar & 0xFF, eventChar & 0x100) != ESP_OK) {
+      _log("USB event char not set");
+    }
+  }
+  return ESP_OK;
 }
 
 bool USBHostSerial::_handle_rx(const uint8_t *data, size_t data_len, void *arg) {
-  std::size_t lenReceived = 0;
-  while (lenReceived < data_len && xRingbufferSend(static_cast<USBHostSerial*>(arg)->_rx_buf_handle, &data[lenReceived], 1, pdMS_TO_TICKS(10)) == pdTRUE) {
-    ++lenReceived;
+  USBHostSerial* thisInstance = static_cast<USBHostSerial*>(arg);
+  if (thisInstance->_overflow_policy == USBHostSerialOverflow::DROP_OLDEST) {
+    thisInstance->_rx_drop_oldest(data_len);
   }
+  const bool wasEmpty = thisInstance->_rx_buf.size() == 0;
+  thisInstance->_rx_last.store(xTaskGetTickCount(), std::memory_order_relaxed);
+  std::size_t lenReceived = thisInstance->_rx_ingest(data, data_len);
+  thisInstance->_rx_notify(wasEmpty);
   if (lenReceived < data_len) {
+    CdcAcmDevice *device = thisInstance->_device.load(std::memory_order_acquire);
+    if (thisInstance->_overflow_policy == USBHostSerialOverflow::BACKPRESSURE && device) {
+      // keep the remainder in the transfer buffer and stop polling the device until the application reads
+      // _rx_held_len is published last: from then on the application side owns the remainder
+      thisInstance->_rx_held_data = data + lenReceived;
+      device->rx_pause();
+      thisInstance->_rx_held_len.store(data_len - lenReceived, std::memory_order_release);
+      return true;
+    }
+    thisInstance->_rx_dropped.fetch_add(data_len - lenReceived, std::memory_order_relaxed);
     // log overflow warning
-    static_cast<USBHostSerial*>(arg)->_log("USB rx buf overflow");
+    char buf[40];
+    snprintf(buf, 40, "USB rx buf overflow: %u-%u", lenReceived, data_len - lenReceived);
+    thisInstance->_log(buf);
   }
   return true;
 }
 
-void USBHostSerial::_handle_event(const cdc_acm_host_dev_event_data_t *event, void *user_ctx) {
-  if (event->type == CDC_ACM_HOST_DEVICE_DISCONNECTED) {
-    xSemaphoreGive(static_cast<USBHostSerial*>(user_ctx)->_device_disconnected_sem);
+std::size_t USBHostSerial::_rx_ingest(const uint8_t *data, std::size_t len) {
+  // runs in the cdc_acm client task: never block, copy as much as fits
+  return _rx_buf.write(data, len);
+}
+
+void USBHostSerial::_rx_drop_oldest(std::size_t len) {
+  // a transfer is never larger than the RX buffer: after this it fits completely
+  const std::size_t space = _rx_buf.space();
+  if (len > space) {
+    _rx_dropped.fetch_add(_rx_buf.drop(len - space), std::memory_order_relaxed);
+  }
+}
+
+void USBHostSerial::_rx_notify(bool wasEmpty) {
+  // wake the waiter when it has enough, or on the first data so it can time the idle gap
+  TaskHandle_t waiter = _rx_waiter.load(std::memory_order_acquire);
+  if (waiter && ((wasEmpty && _rx_idle_gap > 0) || _rx_buf.size() >= _rx_wait_min.load(std::memory_order_relaxed))) {
+    xTaskNotifyGiveIndexed(waiter, USBHOSTSERIAL_RX_NOTIFY_INDEX);
   }
 }
 
-void USBHostSerial::_usb_lib_task(void *arg) {
-  while (1) {
-    uint32_t event_flags;
-    usb_host_lib_handle_events(portMAX_DELAY, &event_flags);
-    if (event_flags & USB_HOST_LIB_EVENT_FLAGS_NO_CLIENTS) {
-      ESP_ERROR_CHECK(usb_host_device_free_all());
+void USBHostSerial::_rx_release_held() {
+  // fast path: nothing held back
+  if (_rx_held_len.load(std::memory_order_acquire) == 0) {
+    return;
+  }
+  // USB polling is paused so the application side is the only producer now
+  // the mutex protects against the device being closed underneath us
+  xSemaphoreTake(_rx_held_mux, portMAX_DELAY);
+  std::size_t len = _rx_held_len.load(std::memory_order_acquire);
+  if (len > 0) {
+    std::size_t accepted = _rx_buf.write(_rx_held_data, len);
+    _rx_held_data += accepted;
+    len -= accepted;
+    _rx_held_len.store(len, std::memory_order_release);
+    if (len == 0) {
+      _device.load(std::memory_order_acquire)->rx_resume();
     }
   }
+  xSemaphoreGive(_rx_held_mux);
+}
+
+void USBHostSerial::_handle_event(const cdc_acm_host_dev_event_data_t *event, void *user_ctx) {
+  USBHostSerial* thisInstance = static_cast<USBHostSerial*>(user_ctx);
+  if (event->type == CDC_ACM_HOST_SERIAL_STATE) {
+    thisInstance->_serial_state.store(event->data.serial_state.val, std::memory_order_relaxed);
+  } else if (event->type == CDC_ACM_HOST_DEVICE_DISCONNECTED) {
+    thisInstance->_serial_state.store(0, std::memory_order_relaxed);
+    xSemaphoreGive(thisInstance->_device_disconnected_sem);
+    thisInstance->_notify_tx(USBHOSTSERIAL_TX_DISCONNECTED);
+  }
+}
+
+void USBHostSerial::_handle_new_dev(uint16_t vid, uint16_t pid) {
+  if ((_vid == CDC_HOST_ANY_VID || _vid == vid) && (_pid == CDC_HOST_ANY_PID || _pid == pid)) {
+    _notify_tx(USBHOSTSERIAL_TX_NEW_DEV);
+  }
 }
 
 void USBHostSerial::_USBHostSerial_task(void *arg) {
   USBHostSerial* thisInstance = static_cast<USBHostSerial*>(arg);
   esp_err_t err = ESP_OK;  // reusable
-  while (1) {
+  bool stop = false;       // end() was called
+  while (!stop) {
+    bool refused = false;  // the device did not accept its settings
+    // forget disconnects of a previous device, attaches from here on wake up the task
+    // settings changed up to here are set by the restore after opening
+    ulTaskNotifyValueClear(nullptr, USBHOSTSERIAL_TX_DISCONNECTED | USBHOSTSERIAL_TX_NEW_DEV | USBHOSTSERIAL_TX_SETTINGS);
+
+    // the other ports of a multi-port device only open on the device of the first port
+    cdc_acm_dev_hdl_t sibling = nullptr;
+    if (thisInstance->_first_port) {
+      sibling = thisInstance->_first_port->_cdc_hdl.load(std::memory_order_acquire);
+    }
+
     // try to open USB VCP device
     const cdc_acm_host_device_config_t dev_config = {
-      .connection_timeout_ms = 10,
-      .out_buffer_size = USBHOSTSERIAL_BUFFERSIZE,
+      .connection_timeout_ms = 1,  // single pass over the connected devices
+      .out_buffer_size = USBHOSTSERIAL_BUFFERSIZE / 2,
       .in_buffer_size = USBHOSTSERIAL_BUFFERSIZE,
       .event_cb = _handle_event,
       .data_cb = _handle_rx,
       .user_arg = thisInstance,
+      .out_transfer_num = 2,  // send one half while the other is on the bus
+      .in_transfer_num = 2,   // keep polling the device while received data is handled
+      .sibling = sibling,
     };
-    cdc_acm_dev_hdl_t cdc_dev = NULL;
-    auto vcp = std::unique_ptr<CdcAcmDevice>(VCP::open(&dev_config));
+    std::unique_ptr<CdcAcmDevice> vcp(thisInstance->_open(&dev_config));
     if (vcp == nullptr) {
-      // try to fallback to CDC
-      err = cdc_acm_host_open(thisInstance->_vid, thisInstance->_pid, 0, &dev_config, &cdc_dev);
-      if (err != ESP_OK) {
-        continue;
-      }
-      thisInstance->_fallback = true;
-      thisInstance->_log("USB CDC device opened");
-    } else {
-      thisInstance->_fallback = false;
-      thisInstance->_log("USB VCP device opened");
+      // no (usable) device: sleep until a matching one is attached
+      uint32_t events = 0;
+      do {
+        xTaskNotifyWait(0, USBHOSTSERIAL_TX_NEW_DEV | USBHOSTSERIAL_TX_END, &events, portMAX_DELAY);
+      } while (!(events & (USBHOSTSERIAL_TX_NEW_DEV | USBHOSTSERIAL_TX_END)));
+      stop = events & USBHOSTSERIAL_TX_END;
+      continue;
     }
+    thisInstance->_log(thisInstance->_fallback ? "USB CDC device opened" : "USB VCP device opened");
+    thisInstance->_remember(vcp.get());
+    thisInstance->_device.store(vcp.get(), std::memory_order_release);
 
     // mark connected
     xSemaphoreTake(thisInstance->_device_disconnected_sem, portMAX_DELAY);
 
-    // set line coding
-    err = ESP_OK;
-    if (thisInstance->_fallback) {
-      err = cdc_acm_host_line_coding_get(cdc_dev, &(thisInstance->_line_coding));
-    } else {
-      err = vcp->line_coding_set(&(thisInstance->_line_coding));
-    }
+    // the other ports of a multi-port device can open now
+    thisInstance->_cdc_hdl.store(vcp->handle(), std::memory_order_release);
+    thisInstance->_notify_ports();
+
+    // set line coding, control lines and device specific settings
+    err = thisInstance->_restore(vcp.get());
     if (err == ESP_OK) {
       thisInstance->_log("USB line coding set");
-    } else {
-      thisInstance->_log("USB line coding error");
-      continue;
-    }
-
-    // all set, enter loop to start sending
-    while (1) {
-      // check if still connected
-      if (xSemaphoreTake(thisInstance->_device_disconnected_sem, 0) == pdTRUE) {
-        break;
+      // all set, enter loop to start sending
+      // the task only wakes up on write or disconnect, there is no polling
+      uint32_t events = 0;
+      std::size_t maxChunk = USBHOSTSERIAL_TX_CHUNK;
+      uint16_t outMps = 0;
+      if (cdc_acm_host_data_mps_get(vcp->handle(), nullptr, &outMps) == ESP_OK && outMps != 0 && outMps < maxChunk) {
+        maxChunk = outMps;
       }
-
-      // check for data to send
-      std::size_t pxItemSize = 0;
-      void *data = xRingbufferReceiveUpTo(thisInstance->_tx_buf_handle, &pxItemSize, pdMS_TO_TICKS(10), USBHOSTSERIAL_BUFFERSIZE);
-      if (data) {
-        if (thisInstance->_fallback) {
-          err = cdc_acm_host_data_tx_blocking(cdc_dev, (uint8_t*)data, pxItemSize, 1000);
-        } else {
-          err = vcp->tx_blocking((uint8_t*)data, pxItemSize, 1000);
+      std::size_t chunk = maxChunk;  // shrinks on errors, grows back on success
+      uint8_t attempt = 0;                         // retries of the data at the front of the TX buffer
+      while (1) {
+        // check if still connected, without blocking
+        uint32_t pending = 0;
+        xTaskNotifyWait(0, USBHOSTSERIAL_TX_DISCONNECTED | USBHOSTSERIAL_TX_SETTINGS | USBHOSTSERIAL_TX_END, &pending, 0);
+        events |= pending;
+        if (events & USBHOSTSERIAL_TX_END) {
+          stop = true;
+          break;
         }
-        if (err == ESP_OK) {
-          vRingbufferReturnItem(thisInstance->_tx_buf_handle, data);
+        if (events & USBHOSTSERIAL_TX_DISCONNECTED) {
+          break;
+        }
+        if (events & USBHOSTSERIAL_TX_SETTINGS) {
+          events &= ~USBHOSTSERIAL_TX_SETTINGS;
+          thisInstance->_restore(vcp.get());
+        }
+
+        // check for data to send
+        const uint8_t *data = nullptr;
+        std::size_t len = thisInstance->_tx_buf.readSpan(&data);
+        if (len > 0) {
+          if (len > chunk) {
+            len = chunk;
+          }
+          err = vcp->tx_blocking(const_cast<uint8_t*>(data), len, 1000);
+          if (err == ESP_OK) {
+            thisInstance->_tx_buf.consume(len);
+            attempt = 0;
+            if (chunk < maxChunk) {
+              chunk = (chunk * 2 < maxChunk) ? chunk * 2 : maxChunk;
+            }
+            continue;
+          }
+
+          // failed: send less at once and pause before the next attempt
+          thisInstance->_tx_error(err);
+          if (chunk > USBHOSTSERIAL_TX_MIN_CHUNK) {
+            chunk /= 2;
+          }
+          uint32_t backoff = 0;
+          if (attempt < thisInstance->_tx_retries) {
+            thisInstance->_tx_stats.retries.fetch_add(1, std::memory_order_relaxed);
+            backoff = 1 << attempt;
+            if (backoff > USBHOSTSERIAL_TX_BACKOFF_MAX) {
+              backoff = USBHOSTSERIAL_TX_BACKOFF_MAX;
+            }
+            ++attempt;
+          } else if (thisInstance->_tx_policy == USBHostSerialTxPolicy::DISCARD) {
+            thisInstance->_tx_buf.consume(len);
+            thisInstance->_tx_stats.discarded.fetch_add(len, std::memory_order_relaxed);
+            thisInstance->_log("USB TX data discarded");
+            attempt = 0;
+          } else {
+            backoff = USBHOSTSERIAL_TX_REQUEUE_DELAY;
+            attempt = 0;
+          }
+          if (backoff > 0) {
+            // a disconnect or end() ends the pause
+            xTaskNotifyWait(0, USBHOSTSERIAL_TX_DISCONNECTED | USBHOSTSERIAL_TX_END, &pending, pdMS_TO_TICKS(backoff));
+            events |= pending;
+          }
         } else {
-          thisInstance->_log("Error writing to USB");
+          // ring is empty: sleep until the next write, settings change, disconnect or end()
+          xTaskNotifyWait(0, USBHOSTSERIAL_TX_DATA | USBHOSTSERIAL_TX_DISCONNECTED | USBHOSTSERIAL_TX_SETTINGS | USBHOSTSERIAL_TX_END, &events, portMAX_DELAY);
         }
       }
-      taskYIELD();
+    } else {
+      thisInstance->_log("USB line coding error");
+      xSemaphoreGive(thisInstance->_device_disconnected_sem);  // device is closed below
+      refused = true;
+    }
+
+    // held RX data lives in the transfer buffer: drop it before the device is closed
+    xSemaphoreTake(thisInstance->_rx_held_mux, portMAX_DELAY);
+    thisInstance->_rx_held_len.store(0, std::memory_order_release);
+    thisInstance->_device.store(nullptr, std::memory_order_release);
+    thisInstance->_cdc_hdl.store(nullptr, std::memory_order_release);
+    xSemaphoreGive(thisInstance->_rx_held_mux);
+
+    // closed here instead of by a disconnect: mark disconnected
+    if (stop) {
+      vcp.reset();
+      xSemaphoreGive(thisInstance->_device_disconnected_sem);
+    }
+
+    // reopening fails the same way: close and sleep until another device is attached or the settings change
+    if (refused) {
+      vcp.reset();
+      uint32_t events = 0;
+      do {
+        xTaskNotifyWait(0, USBHOSTSERIAL_TX_NEW_DEV | USBHOSTSERIAL_TX_SETTINGS | USBHOSTSERIAL_TX_END, &events, portMAX_DELAY);
+      } while (!(events & (USBHOSTSERIAL_TX_NEW_DEV | USBHOSTSERIAL_TX_SETTINGS | USBHOSTSERIAL_TX_END)));
+      stop = events & USBHOSTSERIAL_TX_END;
     }
   }
+
+  // end() detaches from the manager before the task is deleted, so it is never notified after that
+  xSemaphoreGive(thisInstance->_task_stopped_sem);
+  vTaskSuspend(nullptr);
+}
+
+void USBHostSerial::_notify_tx(uint32_t event) {
+  if (_USBHostSerial_task_handle) {
+    xTaskNotify(_USBHostSerial_task_handle, event, eSetBits);
+  }
+}
+
+void USBHostSerial::_notify_ports() {
+  // only the first port has to wake up the others
+  if (_first_port) {
+    return;
+  }
+  for (USBHostSerial *port = _next_port; port; port = port->_next_port) {
+    port->_notify_tx(USBHOSTSERIAL_TX_NEW_DEV);
+  }
+}
+
+void USBHostSerial::_tx_error(esp_err_t err) {
+  switch (err) {
+    case ESP_ERR_TIMEOUT:
+      _tx_stats.timeouts.fetch_add(1, std::memory_order_relaxed);
+      _log("USB TX timeout");
+      break;
+    case ESP_ERR_INVALID_RESPONSE:
+      _tx_stats.failures.fetch_add(1, std::memory_order_relaxed);
+      _log("USB TX transfer failed");
+      break;
+    default:
+      _tx_stats.otherErrors.fetch_add(1, std::memory_order_relaxed);
+      _log("Error writing to USB");
+      break;
+  }
 }
 
 void USBHostSerial::_log(const char* msg) {
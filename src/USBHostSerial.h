@@ -12,13 +12,13 @@ SPDX-License-Identifier: CC0-1.0
 
 #pragma once
 
+#include <atomic>
 #include <cstring>  // std::memcpy
 
 #include "esp_log.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/semphr.h"
-#include "freertos/ringbuf.h"
 
 #include <usb/cdc_acm_host.h>
 #include <usb/vcp_ch34x.hpp>
@@ -27,15 +27,59 @@ SPDX-License-Identifier: CC0-1.0
 #include <usb/vcp.hpp>
 #include <usb/usb_host.h>
 
+#include "USBHostSerialRingbuf.h"
+#include "USBHostSerialManager.h"
+
+// must be a power of 2
+// USB transfers are at least one packet: use 1024 or more for high-speed devices (512 byte packets)
 #ifndef USBHOSTSERIAL_BUFFERSIZE
   #define USBHOSTSERIAL_BUFFERSIZE 256
 #endif
 
+// ms without received data after which a waiting reader gets the data pending, see `setRxIdleGap()`
+#ifndef USBHOSTSERIAL_RX_IDLE_GAP
+  #define USBHOSTSERIAL_RX_IDLE_GAP 2
+#endif
+
+// task notification index `waitForData()` sleeps on
+// set CONFIG_FREERTOS_TASK_NOTIFICATION_ARRAY_ENTRIES to 2 or more to keep it apart from the default index used by
+// xTaskNotifyGive/ulTaskNotifyTake and xTaskNotify/xTaskNotifyWait. with 1 entry both share index 0
+#ifndef USBHOSTSERIAL_RX_NOTIFY_INDEX
+  #define USBHOSTSERIAL_RX_NOTIFY_INDEX (configTASK_NOTIFICATION_ARRAY_ENTRIES - 1)
+#endif
+
 typedef void (*USBHostSerialLoggerFunc)(const char*);
 
+// what to do with received data when the RX buffer is full
+enum class USBHostSerialOverflow : uint8_t {
+  DROP_NEWEST,   // discard the data that doesn't fit (default)
+  DROP_OLDEST,   // discard the oldest buffered data to make room, the device keeps being read, see `consume()`
+  BACKPRESSURE   // stop reading from the device until the application frees up buffer space, nothing is lost
+};
+
+// what to do with TX data the device didn't accept, after the retries are used up
+enum class USBHostSerialTxPolicy : uint8_t {
+  REQUEUE,  // keep the data at the front of the TX buffer and start retrying again after a pause (default)
+  DISCARD   // drop the data and continue with the next
+};
+
+// TX error counters
+struct USBHostSerialTxStats {
+  uint32_t timeouts;      // device didn't accept the data in time
+  uint32_t failures;      // USB transfer failed, eg. stall or bus error
+  uint32_t otherErrors;   // any other error returned by the driver
+  uint32_t retries;       // sends that were repeated after an error
+  std::size_t discarded;  // bytes dropped by the DISCARD policy
+};
+
 class USBHostSerial {
+  friend class USBHostSerialManager;
+  friend class USBHostSerialMultiPort;
+
  public:
-  USBHostSerial(uint16_t vid = CDC_HOST_ANY_VID, uint16_t pid = CDC_HOST_ANY_PID);
+  // any number of instances can coexist (up to USBHOSTSERIAL_MAX_INSTANCES), they share the USB host
+  // each instance opens the first device matching its VID, PID and interface
+  USBHostSerial(uint16_t vid = CDC_HOST_ANY_VID, uint16_t pid = CDC_HOST_ANY_PID, uint8_t interface = 0);
   ~USBHostSerial();
 
   // true if serial-over-usb device is available eg. a device is connected
@@ -46,10 +90,12 @@ class USBHostSerial {
   stopbits: 0: 1 stopbit, 1: 1.5 stopbits, 2: 2 stopbits
   parity: 0: None, 1: Odd, 2: Even, 3: Mark, 4: Space
   databits: 8
+  calling it again while running only changes the line coding
   */
   bool begin(int baud, int stopbits, int parity, int databits);
 
-  // not yet implemented
+  // close the device and stop the TX task. the USB host is uninstalled when this was the last instance
+  // `begin()` starts again. the ports of a multi-port device end together with `USBHostSerialMultiPort::end()`
   void end();
 
   // write one byte to serial-over-usb. returns 0 when buffer is full or device is not available
@@ -58,6 +104,14 @@ class USBHostSerial {
   // write data to serial-over-usb. returns length of data that was actually written: 0 when buffer is full or device is not available
   std::size_t write(const uint8_t *data, std::size_t len);
 
+  // borrow the largest contiguous block of free TX buffer space to fill in place. returns its length: 0 when buffer is full
+  // nothing is sent until the bytes are handed over with `commitWrite()`
+  std::size_t beginWrite(uint8_t **data);
+
+  // hand over `len` bytes, written into the block obtained with `beginWrite()`, for sending
+  // at most the length returned by `beginWrite()` is sent, every `beginWrite()` is followed by one `commitWrite()`
+  void commitWrite(std::size_t len);
+
   // get size of available RX data
   std::size_t available();
 
@@ -67,36 +121,142 @@ class USBHostSerial {
   // read available data into `dest`. returns number of bytes written. maximum number of `size` bytes will be written
   std::size_t read(uint8_t *dest, std::size_t size);
 
+  // same as above but block the calling task up to `timeout` ms until `size` bytes are available or the device goes idle
+  std::size_t read(uint8_t *dest, std::size_t size, uint32_t timeout);
+
+  // block the calling task up to `timeout` ms until `minBytes` are available or the device goes idle with data pending:
+  // nothing received for the idle gap. the task sleeps on task notification USBHOSTSERIAL_RX_NOTIFY_INDEX
+  // returns size of available RX data
+  std::size_t waitForData(std::size_t minBytes, uint32_t timeout);
+
+  // set the idle gap of `waitForData()` in ms (default USBHOSTSERIAL_RX_IDLE_GAP), rounded up to a whole tick
+  // 0: don't return early, wait for `minBytes` or the timeout
+  void setRxIdleGap(uint32_t gapMs);
+
+  // get a pointer to the largest contiguous block of received data without copying. returns its length: 0 when no data is available
+  // the data stays valid until it is released with `consume()`
+  std::size_t readSpan(const uint8_t **data);
+
+  // release `len` bytes previously obtained with `readSpan()`
+  // returns false when DROP_OLDEST discarded some of them in the meantime: the block may have been overwritten by newer data
+  bool consume(std::size_t len);
+
+  // number of received bytes that were dropped because the RX buffer was full
+  std::size_t rxDropped() const;
+
+  // set the policy for received data that doesn't fit in the RX buffer. call before `begin()`
+  void setOverflowPolicy(USBHostSerialOverflow policy);
+
+  // set what happens when sending fails: the data is retried `retries` times, with increasing pause, before `policy` applies
+  // after an error, data is sent in smaller chunks until sending succeeds again
+  void setTxErrorPolicy(USBHostSerialTxPolicy policy, uint8_t retries = 3);
+
+  // get the TX error counters
+  USBHostSerialTxStats txStats() const;
+
+  // set the DTR and RTS control lines. they are set again after every reconnect
+  void setControlLines(bool dtr, bool rts);
+
+  // modem status lines as last reported by the device, false while no device is connected
+  // reported on change by CDC devices, FTDI and CH34x. CTS is only known with FTDI and CH34x
+  bool cts() const;
+  bool dsr() const;
+  bool dcd() const;
+  bool ri() const;
+
+  // FTDI only: send received data to the host after `latencyMs` (1 - 255) of silence instead of the default 16 ms
+  // set again after every reconnect, ignored by other devices
+  void setLatencyTimer(uint8_t latencyMs);
+
+  // FTDI only: send received data to the host right away when `eventChar` is received, eg. the end of a message
+  // set again after every reconnect, ignored by other devices
+  void setEventChar(uint8_t eventChar, bool enable = true);
+
   // add a logger function to direct log messages to
   void setLogger(USBHostSerialLoggerFunc logger);
 
  protected:
-  usb_host_config_t _host_config;
   cdc_acm_line_coding_t _line_coding;
-  uint8_t _tx_buf_mem[USBHOSTSERIAL_BUFFERSIZE];
-  RingbufHandle_t _tx_buf_handle;
-  StaticRingbuffer_t _tx_buf_data;
-  uint8_t _rx_buf_mem[USBHOSTSERIAL_BUFFERSIZE];
-  RingbufHandle_t _rx_buf_handle;
-  StaticRingbuffer_t _rx_buf_data;
+  USBHostSerialRingbuf<USBHOSTSERIAL_BUFFERSIZE> _tx_buf;
+  USBHostSerialRingbuf<USBHOSTSERIAL_BUFFERSIZE> _rx_buf;
+  std::size_t _tx_lent;  // length of the block lent by beginWrite()
+  std::atomic<uint32_t> _rx_dropped;
+  std::atomic<TickType_t> _rx_last;      // tick count of the last received transfer
+  std::atomic<TickType_t> _rx_idle_gap;  // ticks, 0: disabled
+  USBHostSerialOverflow _overflow_policy;
+  USBHostSerialTxPolicy _tx_policy;
+  uint8_t _tx_retries;
+  struct {  // written by the TX task, read by txStats()
+    std::atomic<uint32_t> timeouts;
+    std::atomic<uint32_t> failures;
+    std::atomic<uint32_t> otherErrors;
+    std::atomic<uint32_t> retries;
+    std::atomic<std::size_t> discarded;
+  } _tx_stats;
   bool _setupDone;
 
   bool _fallback;
   uint16_t _vid;
   uint16_t _pid;
+  uint8_t _interface;
+  bool _dtr;
+  bool _rts;
+  bool _control_lines_set;
+  uint8_t _latency;     // 0: not set
+  int16_t _event_char;  // -1: not set, bit 8: enabled
 
- private:
-  void _setup();
+  // last opened device: a reconnect of the same device (VID, PID and serial number) is opened the same way
+  struct {
+    bool valid;
+    uint16_t vid;
+    uint16_t pid;
+    uint32_t serial;        // hash of the serial number string, 0 without one
+    bool fallback;          // opened as plain CDC device instead of with a VCP driver
+    bool noLineCoding;      // the device doesn't accept a line coding
+    bool noControlLines;    // the device doesn't accept DTR/RTS
+  } _last_dev;
+
+  // CDC-ACM driver callbacks, run in the driver task
   static bool _handle_rx(const uint8_t *data, size_t data_len, void *arg);
   static void _handle_event(const cdc_acm_host_dev_event_data_t *event, void *user_ctx);
-  static void _usb_lib_task(void *arg);
+
+ private:
+  void _setup();
+  CdcAcmDevice *_open(const cdc_acm_host_device_config_t *dev_config);
+  CdcAcmDevice *_open_as(uint16_t vid, uint16_t pid, bool fallback, const cdc_acm_host_device_config_t *dev_config);
+  void _remember(CdcAcmDevice *device);
+  esp_err_t _restore(CdcAcmDevice *device);
+  std::size_t _rx_ingest(const uint8_t *data, std::size_t len);
+  void _rx_drop_oldest(std::size_t len);
+  void _rx_release_held();
+  void _rx_notify(bool wasEmpty);
+  void _handle_new_dev(uint16_t vid, uint16_t pid);
   static void _USBHostSerial_task(void *arg);
+  void _notify_tx(uint32_t event);
+  void _notify_ports();
+  void _tx_error(esp_err_t err);
   void _log(const char* msg);
 
   SemaphoreHandle_t _device_disconnected_sem;
-  
-  TaskHandle_t _usb_lib_task_handle;
+  SemaphoreHandle_t _task_stopped_sem;  // given by the TX task when it closed the device after end()
+
+  // RX data held back in the USB transfer buffer while polling is paused
+  SemaphoreHandle_t _rx_held_mux;
+  std::atomic<CdcAcmDevice*> _device;
+  std::atomic<cdc_acm_dev_hdl_t> _cdc_hdl;  // open device, read by the other ports of a multi-port device
+  std::atomic<uint16_t> _serial_state;      // cdc_acm_uart_state_t of the last CDC_ACM_HOST_SERIAL_STATE event
+  const uint8_t *_rx_held_data;
+  std::atomic<std::size_t> _rx_held_len;
+
+  // task blocked in waitForData()
+  std::atomic<TaskHandle_t> _rx_waiter;
+  std::atomic<std::size_t> _rx_wait_min;
+
   TaskHandle_t _USBHostSerial_task_handle;
 
+  // ports of one multi-port device: the other ports open their interface on the device of the first one
+  USBHostSerial *_first_port;
+  USBHostSerial *_next_port;
+
   USBHostSerialLoggerFunc _logger;
 };
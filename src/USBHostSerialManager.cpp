@@ -0,0 +1,187 @@
+/*
+Copyright (c) 2024 Bert Melis. All rights reserved.
+
+This work is licensed under the terms of the MIT license.
+For a copy, see <https://opensource.org/licenses/MIT> or
+the LICENSE file.
+
+Based on example code:
+SPDX-FileCopyrightText: 2022-2024 Espressif Systems (Shanghai) CO LTD
+SPDX-License-Identifier: CC0-1.0
+*/
+
+#include "USBHostSerialManager.h"
+
+#include "esp_log.h"
+#include <usb/cdc_acm_host.h>
+#include <usb/vcp_ch34x.hpp>
+#include <usb/vcp_cp210x.hpp>
+#include <usb/vcp_ftdi.hpp>
+#include <usb/vcp.hpp>
+
+#include "USBHostSerial.h"
+
+using namespace esp_usb;
+
+portMUX_TYPE USBHostSerialManager::_lock = portMUX_INITIALIZER_UNLOCKED;
+USBHostSerial *USBHostSerialManager::_serials[USBHOSTSERIAL_MAX_INSTANCES] = {};
+std::size_t USBHostSerialManager::_count = 0;
+std::size_t USBHostSerialManager::_notifying = 0;
+TaskHandle_t USBHostSerialManager::_usb_lib_task_handle = nullptr;
+volatile bool USBHostSerialManager::_stop = false;
+
+bool USBHostSerialManager::attach(USBHostSerial *serial) {
+  xSemaphoreTake(_mux(), portMAX_DELAY);
+  bool ok = _count < USBHOSTSERIAL_MAX_INSTANCES;
+  if (ok && _count == 0) {
+    ok = _install();
+  }
+  if (ok) {
+    portENTER_CRITICAL(&_lock);
+    _serials[_count++] = serial;
+    portEXIT_CRITICAL(&_lock);
+  }
+  xSemaphoreGive(_mux());
+  return ok;
+}
+
+void USBHostSerialManager::detach(USBHostSerial *serial) {
+  xSemaphoreTake(_mux(), portMAX_DELAY);
+  bool found = false;
+  portENTER_CRITICAL(&_lock);
+  for (std::size_t i = 0; i < _count; ++i) {
+    if (_serials[i] == serial) {
+      _serials[i] = _serials[--_count];
+      _serials[_count] = nullptr;
+      found = true;
+      break;
+    }
+  }
+  portEXIT_CRITICAL(&_lock);
+
+  // a new device notification may still be on its way to the instance: wait until it is delivered
+  while (1) {
+    portENTER_CRITICAL(&_lock);
+    const bool notifying = _notifying > 0;
+    portEXIT_CRITICAL(&_lock);
+    if (!notifying) {
+      break;
+    }
+    vTaskDelay(1);
+  }
+
+  if (found && _count == 0) {
+    _uninstall();
+  }
+  xSemaphoreGive(_mux());
+}
+
+std::size_t USBHostSerialManager::instances() {
+  portENTER_CRITICAL(&_lock);
+  std::size_t count = _count;
+  portEXIT_CRITICAL(&_lock);
+  return count;
+}
+
+bool USBHostSerialManager::_install() {
+  // Install USB Host driver
+  usb_host_config_t host_config = {};
+  host_config.skip_phy_setup = false;
+  host_config.intr_flags = ESP_INTR_FLAG_LEVEL1;
+  if (usb_host_install(&host_config) != ESP_OK) {
+    return false;
+  }
+
+  // Create a task that will handle USB library events
+  _stop = false;
+  if (xTaskCreate(_usb_lib_task, "usb_lib", 4096, nullptr, 1, &_usb_lib_task_handle) != pdTRUE) {
+    usb_host_uninstall();
+    return false;
+  }
+
+  if (cdc_acm_host_install(NULL) != ESP_OK) {
+    _stop_usb_lib_task();
+    return false;
+  }
+
+  // get notified about attached devices instead of polling for them
+  cdc_acm_host_register_new_dev_callback(_handle_new_dev);
+
+  // Register VCP drivers to VCP service
+  VCP::register_driver<FT23x>();
+  VCP::register_driver<CP210x>();
+  VCP::register_driver<CH34x>();
+  return true;
+}
+
+void USBHostSerialManager::_uninstall() {
+  cdc_acm_host_register_new_dev_callback(nullptr);
+  ESP_ERROR_CHECK(cdc_acm_host_uninstall());
+
+  // the USB lib task frees the remaining devices and uninstalls the USB host library
+  _stop_usb_lib_task();
+}
+
+void USBHostSerialManager::_stop_usb_lib_task() {
+  // wait until the host library is uninstalled: the next attach installs it again
+  _stop = true;
+  usb_host_lib_unblock();
+  xSemaphoreTake(_usb_lib_stopped(), portMAX_DELAY);
+}
+
+void USBHostSerialManager::_usb_lib_task(void *arg) {
+  while (!_stop) {
+    uint32_t event_flags;
+    usb_host_lib_handle_events(portMAX_DELAY, &event_flags);
+    if (event_flags & USB_HOST_LIB_EVENT_FLAGS_NO_CLIENTS) {
+      ESP_ERROR_CHECK(usb_host_device_free_all());
+    }
+  }
+
+  // wait for the devices to be freed before the host library is uninstalled
+  while (usb_host_uninstall() != ESP_OK) {
+    uint32_t event_flags;
+    usb_host_lib_handle_events(pdMS_TO_TICKS(10), &event_flags);
+    if (event_flags & USB_HOST_LIB_EVENT_FLAGS_NO_CLIENTS) {
+      usb_host_device_free_all();
+    }
+  }
+  _usb_lib_task_handle = nullptr;
+  xSemaphoreGive(_usb_lib_stopped());
+  vTaskDelete(nullptr);
+}
+
+void USBHostSerialManager::_handle_new_dev(usb_device_handle_t usb_dev) {
+  const usb_device_desc_t *device_desc = nullptr;
+  if (usb_host_get_device_descriptor(usb_dev, &device_desc) != ESP_OK) {
+    return;
+  }
+
+  // notify outside of the critical section
+  USBHostSerial *serials[USBHOSTSERIAL_MAX_INSTANCES];
+  portENTER_CRITICAL(&_lock);
+  std::size_t count = _count;
+  for (std::size_t i = 0; i < count; ++i) {
+    serials[i] = _serials[i];
+  }
+  ++_notifying;
+  portEXIT_CRITICAL(&_lock);
+
+  for (std::size_t i = 0; i < count; ++i) {
+    serials[i]->_handle_new_dev(device_desc->idVendor, device_desc->idProduct);
+  }
+
+  portENTER_CRITICAL(&_lock);
+  --_notifying;
+  portEXIT_CRITICAL(&_lock);
+}
+
+SemaphoreHandle_t USBHostSerialManager::_mux() {
+  static SemaphoreHandle_t mux = xSemaphoreCreateMutex();
+  return mux;
+}
+
+SemaphoreHandle_t USBHostSerialManager::_usb_lib_stopped() {
+  static SemaphoreHandle_t sem = xSemaphoreCreateBinary();
+  return sem;
+}
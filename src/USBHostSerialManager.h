@@ -0,0 +1,61 @@
+/*
+Copyright (c) 2024 Bert Melis. All rights reserved.
+
+This work is licensed under the terms of the MIT license.
+For a copy, see <https://opensource.org/licenses/MIT> or
+the LICENSE file.
+*/
+
+#pragma once
+
+#include <cstddef>  // std::size_t
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+
+#include <usb/usb_host.h>
+
+// maximum number of USBHostSerial instances that can be attached at the same time
+#ifndef USBHOSTSERIAL_MAX_INSTANCES
+  #define USBHOSTSERIAL_MAX_INSTANCES 8
+#endif
+
+class USBHostSerial;
+
+/*
+Owns the USB host library, its event task and the CDC-ACM driver on behalf of all USBHostSerial instances.
+
+The first attached instance installs everything, the last detached one uninstalls it again.
+New USB devices are reported to every attached instance, each instance applies its own VID/PID filter.
+*/
+class USBHostSerialManager {
+ public:
+  // attach an instance, installs the USB host on first use. returns false when the host can't be installed or too many instances are attached
+  static bool attach(USBHostSerial *serial);
+
+  // detach an instance, uninstalls the USB host when it was the last one. all its devices must be closed
+  // the instance isn't notified anymore once this returns
+  static void detach(USBHostSerial *serial);
+
+  // number of attached instances
+  static std::size_t instances();
+
+ private:
+  USBHostSerialManager() = delete;
+
+  static bool _install();
+  static void _uninstall();
+  static void _stop_usb_lib_task();
+  static void _usb_lib_task(void *arg);
+  static void _handle_new_dev(usb_device_handle_t usb_dev);
+  static SemaphoreHandle_t _mux();
+  static SemaphoreHandle_t _usb_lib_stopped();  // given by the USB lib task after the host library is uninstalled
+
+  static portMUX_TYPE _lock;  // guards _serials, which is read from the CDC-ACM driver task
+  static USBHostSerial *_serials[USBHOSTSERIAL_MAX_INSTANCES];
+  static std::size_t _count;
+  static std::size_t _notifying;  // notifications in progress, with copies of _serials
+  static TaskHandle_t _usb_lib_task_handle;
+  static volatile bool _stop;
+};
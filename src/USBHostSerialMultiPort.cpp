@@ -0,0 +1,67 @@
+/*
+Copyright (c) 2024 Bert Melis. All rights reserved.
+
+This work is licensed under the terms of the MIT license.
+For a copy, see <https://opensource.org/licenses/MIT> or
+the LICENSE file.
+*/
+
+#include "USBHostSerialMultiPort.h"
+
+USBHostSerialMultiPort::USBHostSerialMultiPort(uint16_t vid, uint16_t pid, uint8_t ports)
+: _num_ports(ports > USBHOSTSERIAL_MAX_PORTS ? USBHOSTSERIAL_MAX_PORTS : ports)
+, _ports{} {
+  if (_num_ports == 0) {
+    _num_ports = 1;
+  }
+  // port n uses interface n, chained behind port 0
+  for (uint8_t i = 0; i < _num_ports; ++i) {
+    _ports[i] = new USBHostSerial(vid, pid, i);
+    if (i > 0) {
+      _ports[i]->_first_port = _ports[0];
+      _ports[i - 1]->_next_port = _ports[i];
+    }
+  }
+}
+
+USBHostSerialMultiPort::~USBHostSerialMultiPort() {
+  // ended ports don't refer to each other anymore
+  end();
+  for (uint8_t i = 0; i < _num_ports; ++i) {
+    delete _ports[i];
+  }
+}
+
+bool USBHostSerialMultiPort::begin(int baud, int stopbits, int parity, int databits) {
+  bool ok = true;
+  for (uint8_t i = 0; i < _num_ports; ++i) {
+    ok = _ports[i]->begin(baud, stopbits, parity, databits) && ok;
+  }
+  return ok;
+}
+
+void USBHostSerialMultiPort::end() {
+  // port 0 first: once it stopped, nothing wakes the other ports anymore
+  for (uint8_t i = 0; i < _num_ports; ++i) {
+    _ports[i]->end();
+  }
+}
+
+uint8_t USBHostSerialMultiPort::ports() const {
+  return _num_ports;
+}
+
+uint8_t USBHostSerialMultiPort::connected() const {
+  uint8_t count = 0;
+  for (uint8_t i = 0; i < _num_ports; ++i) {
+    if (_ports[i]->_setupDone && *_ports[i]) {
+      ++count;
+    }
+  }
+  return count;
+}
+
+USBHostSerial& USBHostSerialMultiPort::operator[](uint8_t port) {
+  assert(port < _num_ports);
+  return *_ports[port];
+}
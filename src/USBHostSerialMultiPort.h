@@ -0,0 +1,50 @@
+/*
+Copyright (c) 2024 Bert Melis. All rights reserved.
+
+This work is licensed under the terms of the MIT license.
+For a copy, see <https://opensource.org/licenses/MIT> or
+the LICENSE file.
+*/
+
+#pragma once
+
+#include "USBHostSerial.h"
+
+// maximum number of ports of one multi-port device
+#ifndef USBHOSTSERIAL_MAX_PORTS
+  #define USBHOSTSERIAL_MAX_PORTS 4
+#endif
+
+/*
+Opens all UART interfaces (ports) of one multi-port USB-to-UART bridge, eg. CP2105, CP2108, FT2232 or CH342.
+
+Every port is a full USBHostSerial with its own buffers and TX task. Port 0 opens the device like a single USBHostSerial does,
+the other ports then open their interface on that same device: they share its USB device handle and control endpoint.
+Ports that the device doesn't have never connect.
+*/
+class USBHostSerialMultiPort {
+ public:
+  // each port counts as an instance, see USBHOSTSERIAL_MAX_INSTANCES
+  USBHostSerialMultiPort(uint16_t vid = CDC_HOST_ANY_VID, uint16_t pid = CDC_HOST_ANY_PID, uint8_t ports = USBHOSTSERIAL_MAX_PORTS);
+  ~USBHostSerialMultiPort();
+
+  // start all ports with the same line coding, see `USBHostSerial::begin()`
+  // ports can also be started one by one with their own line coding, port 0 has to be started for the others to connect
+  bool begin(int baud, int stopbits, int parity, int databits);
+
+  // end all ports, see `USBHostSerial::end()`
+  void end();
+
+  // number of ports
+  uint8_t ports() const;
+
+  // number of ports with an open interface
+  uint8_t connected() const;
+
+  // access port `port`, which must be smaller than `ports()`
+  USBHostSerial& operator[](uint8_t port);
+
+ private:
+  uint8_t _num_ports;
+  USBHostSerial *_ports[USBHOSTSERIAL_MAX_PORTS];
+};
@@ -0,0 +1,153 @@
+/*
+Copyright (c) 2024 Bert Melis. All rights reserved.
+
+This work is licensed under the terms of the MIT license.
+For a copy, see <https://opensource.org/licenses/MIT> or
+the LICENSE file.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>  // std::size_t
+#include <cstdint>
+#include <cstring>  // std::memcpy
+
+#ifndef USBHOSTSERIAL_CACHELINE
+  #define USBHOSTSERIAL_CACHELINE 64
+#endif
+
+/*
+Lock-free single-producer/single-consumer byte ring.
+
+Exactly one task may call the producer methods (write, writeSpan, commit, drop)
+and exactly one task may call the consumer methods (read, readSpan, consume).
+size() and space() may be called from either side.
+SIZE must be a power of 2, head and tail are free running indices.
+
+The tail normally only moves on the consumer side. drop() lets the producer move it too, to discard the
+oldest data instead of the newest. The consumer moves the tail with compare-and-swap and so notices a drop:
+read() copies again from the new tail, consume() reports that the span may have been overwritten.
+*/
+template <std::size_t SIZE>
+class USBHostSerialRingbuf {
+  static_assert(SIZE > 0 && (SIZE & (SIZE - 1)) == 0, "USBHostSerialRingbuf size must be a power of 2");
+
+ public:
+  USBHostSerialRingbuf()
+  : _head(0)
+  , _tail(0)
+  , _span_tail(0)
+  , _buf{} {}
+
+  // number of bytes available for reading
+  std::size_t size() const {
+    return _head.load(std::memory_order_acquire) - _tail.load(std::memory_order_acquire);
+  }
+
+  // number of bytes available for writing
+  std::size_t space() const {
+    return SIZE - size();
+  }
+
+  static constexpr std::size_t capacity() {
+    return SIZE;
+  }
+
+  // producer: copy up to `len` bytes into the ring, returns number of bytes copied
+  std::size_t write(const uint8_t *data, std::size_t len) {
+    const std::size_t head = _head.load(std::memory_order_relaxed);
+    const std::size_t free = SIZE - (head - _tail.load(std::memory_order_acquire));
+    if (len > free) {
+      len = free;
+    }
+    const std::size_t offset = head & (SIZE - 1);
+    const std::size_t first = (len < SIZE - offset) ? len : SIZE - offset;
+    std::memcpy(&_buf[offset], data, first);
+    std::memcpy(&_buf[0], data + first, len - first);
+    _head.store(head + len, std::memory_order_release);
+    return len;
+  }
+
+  // producer: get the largest contiguous writable region, returns its length
+  std::size_t writeSpan(uint8_t **data) {
+    const std::size_t head = _head.load(std::memory_order_relaxed);
+    const std::size_t free = SIZE - (head - _tail.load(std::memory_order_acquire));
+    const std::size_t offset = head & (SIZE - 1);
+    *data = &_buf[offset];
+    return (free < SIZE - offset) ? free : SIZE - offset;
+  }
+
+  // producer: publish `len` bytes written into the region returned by writeSpan
+  void commit(std::size_t len) {
+    _head.store(_head.load(std::memory_order_relaxed) + len, std::memory_order_release);
+  }
+
+  // producer: discard up to `len` of the oldest bytes, returns number of bytes discarded
+  std::size_t drop(std::size_t len) {
+    std::size_t tail = _tail.load(std::memory_order_acquire);
+    while (1) {
+      const std::size_t used = _head.load(std::memory_order_relaxed) - tail;
+      const std::size_t n = (len < used) ? len : used;
+      if (n == 0 || _tail.compare_exchange_weak(tail, tail + n, std::memory_order_acq_rel, std::memory_order_acquire)) {
+        return n;
+      }
+    }
+  }
+
+  // consumer: copy up to `len` bytes out of the ring, returns number of bytes copied
+  std::size_t read(uint8_t *dest, std::size_t len) {
+    std::size_t tail = _tail.load(std::memory_order_acquire);
+    while (1) {
+      const std::size_t used = _head.load(std::memory_order_acquire) - tail;
+      const std::size_t n = (len < used) ? len : used;
+      const std::size_t offset = tail & (SIZE - 1);
+      const std::size_t first = (n < SIZE - offset) ? n : SIZE - offset;
+      std::memcpy(dest, &_buf[offset], first);
+      std::memcpy(dest + first, &_buf[0], n - first);
+      // a failed swap means the producer dropped data meanwhile: the copy may hold newer data, copy again
+      if (_tail.compare_exchange_strong(tail, tail + n, std::memory_order_acq_rel, std::memory_order_acquire)) {
+        _span_tail = tail + n;
+        return n;
+      }
+    }
+  }
+
+  // consumer: get the largest contiguous readable region, returns its length
+  std::size_t readSpan(const uint8_t **data) {
+    const std::size_t tail = _tail.load(std::memory_order_acquire);
+    const std::size_t used = _head.load(std::memory_order_acquire) - tail;
+    const std::size_t offset = tail & (SIZE - 1);
+    _span_tail = tail;
+    *data = &_buf[offset];
+    return (used < SIZE - offset) ? used : SIZE - offset;
+  }
+
+  // consumer: release `len` bytes previously obtained with readSpan
+  // returns false when the producer dropped some of them meanwhile: the region may hold newer data by now
+  bool consume(std::size_t len) {
+    const std::size_t start = _span_tail;
+    const std::size_t used = _head.load(std::memory_order_acquire) - start;
+    if (len > used) {
+      len = used;
+    }
+    bool intact = true;
+    std::size_t tail = start;
+    while (!_tail.compare_exchange_weak(tail, start + len, std::memory_order_acq_rel, std::memory_order_acquire)) {
+      if (tail != start) {
+        intact = false;
+        if (tail - start >= len) {
+          break;  // all of it was dropped already
+        }
+      }
+    }
+    _span_tail = (tail - start >= len) ? tail : start + len;
+    return intact;
+  }
+
+ private:
+  alignas(USBHOSTSERIAL_CACHELINE) std::atomic<std::size_t> _head;  // written by producer only
+  alignas(USBHOSTSERIAL_CACHELINE) std::atomic<std::size_t> _tail;  // written by consumer, and by producer in drop()
+  std::size_t _span_tail;                                            // consumer: tail at the last read, readSpan or consume
+  alignas(USBHOSTSERIAL_CACHELINE) uint8_t _buf[SIZE];
+};
@@ -32,16 +32,51 @@
 })
 
 typedef struct cdc_dev_s cdc_dev_t;
+typedef struct cdc_out_slot_s cdc_out_slot_t; // OUT data transfer of the pool, private to cdc_acm_host.c
+
+// State the device was last set to, kept by the driver after close while the device stays connected
+typedef struct {
+    cdc_acm_line_coding_t line_coding;    // Line coding the device was last set to, zeroed parts are unknown
+    bool ctrl_lines_valid;                // ctrl_lines holds the state the device was last set to
+    uint8_t ctrl_lines;                   // DTR in bit 0, RTS in bit 1
+    uint8_t vendor_valid;                 // Bit n set: vendor[n] holds the setting the device was last set to
+    uint16_t vendor[2];                   // Settings of vendor drivers, eg. FTDI latency timer and event character
+} cdc_line_state_t;
 struct cdc_dev_s {
     cdc_acm_intf_t intf_func;             // CDC interface function table
+    void *intf_ctx;                       // State of the driver that set intf_func, freed with the device
     usb_device_handle_t dev_hdl;          // USB device handle
+    uint8_t dev_addr;                     // USB device address, index into the driver's table of open devices
+    uint32_t intf_bit;                    // Bit of interface_idx in the open interfaces of this USB device, 0 if not tracked
     void *cb_arg;                         // Common argument for user's callbacks (data IN and Notification)
     struct {
-        usb_transfer_t *out_xfer;         // OUT data transfer
-        usb_transfer_t *in_xfer;          // IN data transfer
+        cdc_out_slot_t *out_slots;        // Pool of OUT data transfers
+        uint8_t out_slot_cnt;             // Number of OUT data transfers in the pool
+        uint16_t out_mps;                 // OUT endpoint Maximum Packet Size
+        SemaphoreHandle_t out_free;       // Counting semaphore of OUT data transfers that are not in flight
+        SemaphoreHandle_t out_done;       // Counting semaphore of completed OUT transfers of a blocking transmit
+        esp_err_t out_err;                // Result of a blocking transmit, set from the completion callback
+        uint8_t out_done_owed;            // Completions of timed out blocking transfers that are still to come, protected by out_mux
+        size_t out_queued;                // Number of bytes in OUT data transfers in flight
+        usb_transfer_t **in_xfers;        // IN data transfers, all queued on the IN endpoint
+        uint8_t in_xfer_cnt;              // Number of IN data transfers
         cdc_acm_data_callback_t in_cb;    // User's callback for async (non-blocking) data IN
+        bool in_paused;                   // IN transfers are not resubmitted after they complete
+        uint8_t in_held_cnt;              // Number of completed IN transfers held back while paused
+        bool in_held_delivered;           // The first held IN transfer was already passed to in_cb
+        usb_transfer_t **in_held;         // Held IN transfers in completion order
         uint16_t in_mps;                  // IN endpoint Maximum Packet Size
-        uint8_t *in_data_buffer_base;     // Pointer to IN data buffer in usb_transfer_t
+        uint8_t *in_data_buffer_base;     // Pointer to IN data buffer in usb_transfer_t, single IN transfer only
+        struct {
+            uint8_t state;                // IN pipe recovery state
+            uint8_t attempt;              // Recovery attempts since IN data was last received
+            uint8_t pending;              // Flushed IN transfers that did not return yet
+            bool ctrl_busy;               // CLEAR_FEATURE request is in flight
+            TickType_t started;           // Tick count of the error that started the recovery
+            TickType_t due;               // Tick count of the next recovery attempt
+            usb_transfer_t *ctrl;         // CTRL transfer for CLEAR_FEATURE(ENDPOINT_HALT), allocated on first use
+            cdc_acm_host_rx_stats_t stats;
+        } in_recovery;
         const usb_intf_desc_t *intf_desc; // Pointer to data interface descriptor
         SemaphoreHandle_t out_mux;        // OUT mutex
     } data;
@@ -55,6 +90,7 @@ struct cdc_dev_s {
     usb_transfer_t *ctrl_transfer;        // CTRL (endpoint 0) transfer
     SemaphoreHandle_t ctrl_mux;           // CTRL mutex
     cdc_acm_uart_state_t serial_state;    // Serial State
+    cdc_line_state_t line_state;          // Skips requests that would not change anything
     cdc_comm_protocol_t comm_protocol;
     cdc_data_protocol_t data_protocol;
     int cdc_func_desc_cnt;                // Number of CDC Functional descriptors in following array
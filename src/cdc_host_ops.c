@@ -4,9 +4,11 @@
  * SPDX-License-Identifier: Apache-2.0
  */
 
+#include <string.h>
 #include "esp_check.h"
 #include "usb/cdc_acm_host_ops.h"
 #include "cdc_host_common.h"
+#include "cdc_host_acm_compliant.h"
 
 static const char *TAG = "cdc_acm_ops";
 
@@ -15,7 +17,40 @@ esp_err_t cdc_acm_host_line_coding_set(cdc_acm_dev_hdl_t cdc_hdl, const cdc_acm_
     ESP_RETURN_ON_FALSE(cdc_hdl, ESP_ERR_INVALID_ARG, TAG, "invalid CDC handle");
     ESP_RETURN_ON_FALSE(line_coding, ESP_ERR_INVALID_ARG, TAG, "line_coding can't be NULL");
     ESP_RETURN_ON_FALSE(cdc_hdl->intf_func.line_coding_set, ESP_ERR_NOT_SUPPORTED, TAG, "line_coding_set function not supported");
-    return cdc_hdl->intf_func.line_coding_set(cdc_hdl, line_coding);
+
+    cdc_acm_line_coding_t *current = &cdc_hdl->line_state.line_coding;
+    const bool same_rate = (line_coding->dwDTERate == current->dwDTERate);
+    const bool same_format = (line_coding->bDataBits == current->bDataBits) &&
+                             (line_coding->bParityType == current->bParityType) &&
+                             (line_coding->bCharFormat == current->bCharFormat);
+    if (same_rate && same_format) {
+        return ESP_OK; // The device is already set to this line coding
+    }
+
+    // Vendor drivers leave zeroed parts unchanged, so only what differs is sent
+    cdc_acm_line_coding_t changed = *line_coding;
+    if (cdc_hdl->intf_func.line_coding_set != acm_compliant_line_coding_set) {
+        if (same_rate) {
+            changed.dwDTERate = 0;
+        }
+        if (same_format) {
+            changed.bDataBits = 0;
+        }
+    }
+    const esp_err_t ret = cdc_hdl->intf_func.line_coding_set(cdc_hdl, &changed);
+    if (ret != ESP_OK) {
+        memset(current, 0, sizeof(cdc_acm_line_coding_t)); // A part might have been set
+        return ret;
+    }
+    if (line_coding->dwDTERate != 0) {
+        current->dwDTERate = line_coding->dwDTERate;
+    }
+    if (line_coding->bDataBits != 0) {
+        current->bDataBits = line_coding->bDataBits;
+        current->bParityType = line_coding->bParityType;
+        current->bCharFormat = line_coding->bCharFormat;
+    }
+    return ESP_OK;
 }
 
 esp_err_t cdc_acm_host_line_coding_get(cdc_acm_dev_hdl_t cdc_hdl, cdc_acm_line_coding_t *line_coding)
@@ -23,14 +58,24 @@ esp_err_t cdc_acm_host_line_coding_get(cdc_acm_dev_hdl_t cdc_hdl, cdc_acm_line_c
     ESP_RETURN_ON_FALSE(cdc_hdl, ESP_ERR_INVALID_ARG, TAG, "invalid CDC handle");
     ESP_RETURN_ON_FALSE(line_coding, ESP_ERR_INVALID_ARG, TAG, "line_coding can't be NULL");
     ESP_RETURN_ON_FALSE(cdc_hdl->intf_func.line_coding_get, ESP_ERR_NOT_SUPPORTED, TAG, "line_coding_get function not supported");
-    return cdc_hdl->intf_func.line_coding_get(cdc_hdl, line_coding);
+    ESP_RETURN_ON_ERROR(cdc_hdl->intf_func.line_coding_get(cdc_hdl, line_coding), TAG,);
+    cdc_hdl->line_state.line_coding = *line_coding;
+    return ESP_OK;
 }
 
 esp_err_t cdc_acm_host_set_control_line_state(cdc_acm_dev_hdl_t cdc_hdl, bool dtr, bool rts)
 {
     ESP_RETURN_ON_FALSE(cdc_hdl, ESP_ERR_INVALID_ARG, TAG, "invalid CDC handle");
     ESP_RETURN_ON_FALSE(cdc_hdl->intf_func.set_control_line_state, ESP_ERR_NOT_SUPPORTED, TAG, "set_control_line_state function not supported");
-    return cdc_hdl->intf_func.set_control_line_state(cdc_hdl, dtr, rts);
+
+    const uint8_t ctrl_lines = (uint8_t)dtr | ((uint8_t)rts << 1);
+    if (cdc_hdl->line_state.ctrl_lines_valid && cdc_hdl->line_state.ctrl_lines == ctrl_lines) {
+        return ESP_OK; // The device is already set to this state
+    }
+    const esp_err_t ret = cdc_hdl->intf_func.set_control_line_state(cdc_hdl, dtr, rts);
+    cdc_hdl->line_state.ctrl_lines_valid = (ret == ESP_OK);
+    cdc_hdl->line_state.ctrl_lines = ctrl_lines;
+    return ret;
 }
 
 esp_err_t cdc_acm_host_send_break(cdc_acm_dev_hdl_t cdc_hdl, uint16_t duration_ms)
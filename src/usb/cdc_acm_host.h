@@ -17,6 +17,9 @@
 #define CDC_HOST_ANY_VID (0)
 #define CDC_HOST_ANY_PID (0)
 
+// Maximum number of USB devices: the whole USB address space, devices behind hubs included
+#define CDC_HOST_MAX_DEVICES (127)
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -63,7 +66,7 @@ esp_err_t cdc_acm_host_install(const cdc_acm_host_driver_config_t *driver_config
  *
  * @return
  *   - ESP_OK: Success
- *   - ESP_ERR_INVALID_STATE: The CDC driver is not installed or not all CDC devices are closed
+ *   - ESP_ERR_INVALID_STATE: The CDC driver is not installed or not all CDC devices are closed, or a device is being opened or closed
  *   - ESP_ERR_NOT_FINISHED: The CDC driver failed to uninstall completely
  */
 esp_err_t cdc_acm_host_uninstall(void);
@@ -79,6 +82,22 @@ esp_err_t cdc_acm_host_uninstall(void);
  */
 esp_err_t cdc_acm_host_register_new_dev_callback(cdc_acm_new_dev_callback_t new_dev_cb);
 
+/**
+ * @brief Get VID and PID of connected USB devices
+ *
+ * Reads the device descriptors cached by USB Host Library, there is no USB traffic.
+ * Use it to pick a device before opening it.
+ *
+ * @param[in]  list_len     Length of vid_pid_list
+ * @param[out] vid_pid_list VID in the upper and PID in the lower 16 bits, per connected device
+ * @param[out] num_ret      Number of entries filled in vid_pid_list
+ * @return
+ *   - ESP_OK: Success
+ *   - ESP_ERR_INVALID_STATE: The CDC driver is not installed
+ *   - ESP_ERR_INVALID_ARG: vid_pid_list or num_ret is NULL
+ */
+esp_err_t cdc_acm_host_device_ids_get(size_t list_len, uint32_t *vid_pid_list, int *num_ret);
+
 /**
  * @brief Open CDC-ACM device
  *
@@ -87,6 +106,9 @@ esp_err_t cdc_acm_host_register_new_dev_callback(cdc_acm_new_dev_callback_t new_
  * Use CDC_HOST_ANY_* macros to signal that you don't care about the device's VID and PID. In this case, first USB device will be opened.
  * It is recommended to use this feature if only one device can ever be in the system (there is no USB HUB connected).
  *
+ * Interfaces of multi-port devices (eg. CP2105, CP2108 or FT2232) can be opened independently, each gets its own CDC handle and transfers.
+ * Set dev_config->sibling to an open handle of the same device to make sure the interface is opened on that device and not on another one with the same VID/PID.
+ *
  * @param[in] vid           Device's Vendor ID, set to CDC_HOST_ANY_VID for any
  * @param[in] pid           Device's Product ID, set to CDC_HOST_ANY_PID for any
  * @param[in] interface_idx Index of device's interface used for CDC-ACM communication
@@ -97,7 +119,8 @@ esp_err_t cdc_acm_host_register_new_dev_callback(cdc_acm_new_dev_callback_t new_
  *   - ESP_ERR_INVALID_STATE: The CDC driver is not installed
  *   - ESP_ERR_INVALID_ARG: dev_config or cdc_hdl_ret is NULL
  *   - ESP_ERR_NO_MEM: Not enough memory for opening the device
- *   - ESP_ERR_NOT_FOUND: USB device with specified VID/PID is not connected or does not have specified interface
+ *   - ESP_ERR_NOT_FOUND: USB device with specified VID/PID is not connected or does not have specified interface,
+ *                        or the sibling device is closed or its interface is already open
  */
 esp_err_t cdc_acm_host_open(uint16_t vid, uint16_t pid, uint8_t interface_idx, const cdc_acm_host_device_config_t *dev_config, cdc_acm_dev_hdl_t *cdc_hdl_ret);
 
@@ -121,6 +144,10 @@ esp_err_t cdc_acm_host_close(cdc_acm_dev_hdl_t cdc_hdl);
 /**
  * @brief Transmit data - blocking mode
  *
+ * Data longer than out_buffer_size is split into chunks. With out_transfer_num > 1 the next chunk is submitted
+ * while the previous one is still on the bus. If the data length is a multiple of the OUT endpoint's
+ * Maximum Packet Size, a zero length packet is sent after the last chunk.
+ *
  * @param cdc_hdl CDC handle obtained from cdc_acm_host_open()
  * @param[in] data       Data to be sent
  * @param[in] data_len   Data length
@@ -129,6 +156,97 @@ esp_err_t cdc_acm_host_close(cdc_acm_dev_hdl_t cdc_hdl);
  */
 esp_err_t cdc_acm_host_data_tx_blocking(cdc_acm_dev_hdl_t cdc_hdl, const uint8_t *data, size_t data_len, uint32_t timeout_ms);
 
+/**
+ * @brief Transmit data - non-blocking mode
+ *
+ * Data is copied into a free OUT transfer and submitted, the function returns immediately.
+ * Completion is reported with tx_cb from the CDC-ACM driver task. Up to out_transfer_num transmissions can be in flight.
+ * A zero length packet is appended if data_len is a multiple of the OUT endpoint's Maximum Packet Size.
+ *
+ * @note All transmissions must be completed before the device is closed.
+ * @param cdc_hdl CDC handle obtained from cdc_acm_host_open()
+ * @param[in] data     Data to be sent
+ * @param[in] data_len Data length, at most out_buffer_size
+ * @param[in] tx_cb    Completion callback, can be NULL
+ * @param[in] user_arg Argument passed to tx_cb
+ * @return
+ *   - ESP_OK: Data queued for transmission
+ *   - ESP_ERR_INVALID_ARG: Invalid input arguments
+ *   - ESP_ERR_NOT_SUPPORTED: The device was opened as read-only
+ *   - ESP_ERR_INVALID_SIZE: data_len is larger than out_buffer_size
+ *   - ESP_ERR_NO_MEM: All OUT transfers are in flight, try again after a completion
+ */
+esp_err_t cdc_acm_host_data_tx_async(cdc_acm_dev_hdl_t cdc_hdl, const uint8_t *data, size_t data_len, cdc_acm_tx_callback_t tx_cb, void *user_arg);
+
+/**
+ * @brief Get number of bytes queued for transmission
+ *
+ * @param cdc_hdl CDC handle obtained from cdc_acm_host_open()
+ * @param[out] queued_ret Number of bytes in OUT transfers that are not completed yet
+ * @return
+ *   - ESP_OK: Success
+ *   - ESP_ERR_INVALID_ARG: Invalid input arguments
+ *   - ESP_ERR_NOT_SUPPORTED: The device was opened as read-only
+ */
+esp_err_t cdc_acm_host_data_tx_queued(cdc_acm_dev_hdl_t cdc_hdl, size_t *queued_ret);
+
+/**
+ * @brief Pause polling of data IN endpoint
+ *
+ * IN transfers are not resubmitted after they complete. Data the device cannot send stays in the device,
+ * so its flow control throttles the remote sender until polling is resumed with cdc_acm_host_data_rx_resume().
+ * This function can be called from the data received callback, the data passed to the callback stays valid until resume.
+ * With multiple IN transfers, the ones that complete while paused are held and passed to the data callback, in order,
+ * after resume.
+ *
+ * @param cdc_hdl CDC handle obtained from cdc_acm_host_open()
+ * @return
+ *   - ESP_OK: Success
+ *   - ESP_ERR_INVALID_ARG: Invalid device
+ *   - ESP_ERR_NOT_SUPPORTED: The device was opened as write-only
+ */
+esp_err_t cdc_acm_host_data_rx_pause(cdc_acm_dev_hdl_t cdc_hdl);
+
+/**
+ * @brief Resume polling of data IN endpoint
+ *
+ * @param cdc_hdl CDC handle obtained from cdc_acm_host_open()
+ * @return
+ *   - ESP_OK: Success
+ *   - ESP_ERR_INVALID_ARG: Invalid device
+ *   - ESP_ERR_NOT_SUPPORTED: The device was opened as write-only
+ */
+esp_err_t cdc_acm_host_data_rx_resume(cdc_acm_dev_hdl_t cdc_hdl);
+
+/**
+ * @brief Get data IN pipe error and recovery statistics
+ *
+ * After a bulk IN transfer error, the driver halts and flushes the IN endpoint, clears the halt condition on the device
+ * and restarts polling. Failed attempts are retried with exponential backoff, up to a bounded number of times.
+ *
+ * @param cdc_hdl CDC handle obtained from cdc_acm_host_open()
+ * @param[out] stats_ret Statistics since the device was opened
+ * @return
+ *   - ESP_OK: Success
+ *   - ESP_ERR_INVALID_ARG: Invalid input arguments
+ *   - ESP_ERR_NOT_SUPPORTED: The device was opened as write-only
+ */
+esp_err_t cdc_acm_host_data_rx_stats_get(cdc_acm_dev_hdl_t cdc_hdl, cdc_acm_host_rx_stats_t *stats_ret);
+
+/**
+ * @brief Get Maximum Packet Size of the data endpoints
+ *
+ * Drivers of devices that frame the data per USB packet use it to parse IN transfers that span several packets.
+ *
+ * @param cdc_hdl      CDC handle obtained from cdc_acm_host_open()
+ * @param[out] in_mps  IN endpoint Maximum Packet Size, 0 for a write-only device. Can be NULL
+ * @param[out] out_mps OUT endpoint Maximum Packet Size, 0 for a read-only device. Can be NULL
+ * @return
+ *   - ESP_OK: Success
+ *   - ESP_ERR_INVALID_ARG: Invalid device
+ */
+esp_err_t cdc_acm_host_data_mps_get(cdc_acm_dev_hdl_t cdc_hdl, uint16_t *in_mps, uint16_t *out_mps);
+
 /**
  * @brief Print device's descriptors
  *
@@ -138,6 +256,20 @@ esp_err_t cdc_acm_host_data_tx_blocking(cdc_acm_dev_hdl_t cdc_hdl, const uint8_t
  */
 void cdc_acm_host_desc_print(cdc_acm_dev_hdl_t cdc_hdl);
 
+/**
+ * @brief Get device descriptor and info of the USB device
+ *
+ * Use eg. the serial number string to recognize a device that was connected before.
+ *
+ * @param cdc_hdl              CDC handle obtained from cdc_acm_host_open()
+ * @param[out] device_desc_ret Device descriptor, can be NULL
+ * @param[out] dev_info_ret    Device info, can be NULL
+ * @return
+ *   - ESP_OK: Success
+ *   - ESP_ERR_INVALID_ARG: Invalid device
+ */
+esp_err_t cdc_acm_host_device_info_get(cdc_acm_dev_hdl_t cdc_hdl, const usb_device_desc_t **device_desc_ret, usb_device_info_t *dev_info_ret);
+
 /**
  * @brief Get protocols defined in USB-CDC interface descriptors
  *
@@ -177,7 +309,13 @@ esp_err_t cdc_acm_host_cdc_desc_get(cdc_acm_dev_hdl_t cdc_hdl, cdc_desc_subtype_
  * @param[in]    wIndex        Field of USB control request
  * @param[in]    wLength       Field of USB control request
  * @param[inout] data          Field of USB control request
- * @return esp_err_t
+ * @return
+ *   - ESP_OK: Success
+ *   - ESP_ERR_INVALID_ARG: Invalid device or data
+ *   - ESP_ERR_INVALID_SIZE: wLength does not fit CTRL data buffer
+ *   - ESP_ERR_TIMEOUT: Request timeout
+ *   - ESP_ERR_NOT_SUPPORTED: The device stalled the request: it doesn't support it
+ *   - ESP_ERR_INVALID_RESPONSE: Control transfer failed otherwise
  */
 esp_err_t cdc_acm_host_send_custom_request(cdc_acm_dev_hdl_t cdc_hdl, uint8_t bmRequestType, uint8_t bRequest, uint16_t wValue, uint16_t wIndex, uint16_t wLength, uint8_t *data);
 
@@ -200,6 +338,43 @@ public:
         return cdc_acm_host_data_tx_blocking(this->cdc_hdl, data, len, timeout_ms);
     }
 
+    inline esp_err_t tx_async(const uint8_t *data, size_t data_len, cdc_acm_tx_callback_t tx_cb = nullptr, void *user_arg = nullptr)
+    {
+        return cdc_acm_host_data_tx_async(this->cdc_hdl, data, data_len, tx_cb, user_arg);
+    }
+
+    inline size_t tx_queued()
+    {
+        size_t queued = 0;
+        cdc_acm_host_data_tx_queued(this->cdc_hdl, &queued);
+        return queued;
+    }
+
+    inline esp_err_t rx_pause()
+    {
+        return cdc_acm_host_data_rx_pause(this->cdc_hdl);
+    }
+
+    inline esp_err_t rx_resume()
+    {
+        return cdc_acm_host_data_rx_resume(this->cdc_hdl);
+    }
+
+    inline esp_err_t rx_stats(cdc_acm_host_rx_stats_t *stats)
+    {
+        return cdc_acm_host_data_rx_stats_get(this->cdc_hdl, stats);
+    }
+
+    inline cdc_acm_dev_hdl_t handle() const
+    {
+        return this->cdc_hdl;
+    }
+
+    inline esp_err_t device_info(const usb_device_desc_t **device_desc, usb_device_info_t *dev_info) const
+    {
+        return cdc_acm_host_device_info_get(this->cdc_hdl, device_desc, dev_info);
+    }
+
     inline esp_err_t open(uint16_t vid, uint16_t pid, uint8_t interface_idx, const cdc_acm_host_device_config_t *dev_config)
     {
         return cdc_acm_host_open(vid, pid, interface_idx, dev_config, &this->cdc_hdl);
@@ -6,6 +6,7 @@
 #pragma once
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 #include "esp_err.h"
 
@@ -23,12 +24,25 @@ typedef struct cdc_acm_intf_t cdc_acm_intf_t;
  *
  * CDC-ACM like devices (such as USB<->Serial converters) can be implemented in different ways.
  * Use this interface to implement CDC-ACM like devices that are not compliant with CDC-ACM specification.
+ *
+ * line_coding_set must leave the baudrate unchanged when dwDTERate is 0,
+ * and the data bits, parity and stop bits unchanged when bDataBits is 0.
+ *
+ * notif_decode is optional. When set, it decodes every packet of the notification (interrupt IN) endpoint instead of the CDC
+ * notification parser. It is called from the CDC-ACM driver task with the current serial state in serial_state, and returns true
+ * after updating it. A CDC_ACM_HOST_SERIAL_STATE event is sent when the new state differs from the current one.
+ *
+ * rx_decode is optional. When set, it decodes every IN transfer in place right before the data callback gets it, eg. to remove
+ * vendor specific status from the data stream. It is called from the CDC-ACM driver task, once per transfer and in the order
+ * the data is delivered, and returns the number of data bytes left at the start of the buffer.
  */
 struct cdc_acm_intf_t {
     esp_err_t (*line_coding_set)(cdc_acm_dev_hdl_t cdc_hdl, const cdc_acm_line_coding_t *line_coding);
     esp_err_t (*line_coding_get)(cdc_acm_dev_hdl_t cdc_hdl, cdc_acm_line_coding_t *line_coding);
     esp_err_t (*set_control_line_state)(cdc_acm_dev_hdl_t cdc_hdl, bool dtr, bool rts);
     esp_err_t (*send_break)(cdc_acm_dev_hdl_t cdc_hdl, uint16_t duration_ms);
+    bool (*notif_decode)(cdc_acm_dev_hdl_t cdc_hdl, const uint8_t *data, size_t data_len, cdc_acm_uart_state_t *serial_state);
+    size_t (*rx_decode)(cdc_acm_dev_hdl_t cdc_hdl, uint8_t *data, size_t data_len);
 };
 
 #ifdef __cplusplus
@@ -40,6 +40,8 @@ public:
      * #. pids: Array of supported PIDs
      * # Constructor with (uint16_t pid, const cdc_acm_host_device_config_t *dev_config, uint8_t interface_idx) input parameters
      *
+     * If a VID/PID pair is supported by more drivers, the first registered one is used.
+     *
      * @tparam T VCP driver type
      */
     template<class T> static void
@@ -47,13 +49,23 @@ public:
     {
         static_assert(T::pids.begin() != nullptr, "Every VCP driver must contain array of supported PIDs in 'pids' array");
         static_assert(T::vid != 0, "Every VCP driver must contain supported VID in'vid' integer");
-        std::vector<uint16_t> pids(T::pids.begin(), T::pids.end()); // Convert array to vector
-        vcp_driver new_driver = vcp_driver([](uint16_t pid, const cdc_acm_host_device_config_t *dev_config, uint8_t interface_idx) {
-            return static_cast<CdcAcmDevice *> (new T(pid, dev_config, interface_idx)); // Lambda function: Open factory method
-        }, T::vid, pids);
-        drivers.push_back(new_driver);
+        for (uint16_t pid : T::pids) {
+            add_driver(T::vid, pid, [](uint16_t pid, const cdc_acm_host_device_config_t *dev_config, uint8_t interface_idx) {
+                return static_cast<CdcAcmDevice *> (new T(pid, dev_config, interface_idx)); // Lambda function: Open factory method
+            });
+        }
     }
 
+    /**
+     * @brief Check if a registered driver supports the device
+     *
+     * @param[in] _vid VID of the device
+     * @param[in] _pid PID of the device
+     * @return true if VCP::open() can open the device
+     */
+    static bool
+    is_supported(uint16_t _vid, uint16_t _pid);
+
     /**
      * @brief VCP factory with VID and PID
      *
@@ -81,6 +93,7 @@ public:
      * until dev_config->connection_timeout_ms expires. Set timeout to 0 to wait forever.
      *
      * @note If there are more USB devices connected, the VCP service will return first successfully opened device
+     * @note The connected devices are matched by their (cached) device descriptors, only a supported device is opened
      * @attention USB Host Library must be installed before calling this function!
      *
      * @param[in] dev_config    Configuration of the device
@@ -98,18 +111,32 @@ private:
     bool operator== (const VCP &param) = delete;
     bool operator!= (const VCP &param) = delete;
 
+    typedef CdcAcmDevice *(*open_func_t)(uint16_t pid, const cdc_acm_host_device_config_t *dev_config, uint8_t interface_idx);
+
     /**
-     * @brief VCP driver structure
+     * @brief VCP driver structure, one per supported VID/PID pair
      */
     typedef struct vcp_driver {
-        CdcAcmDevice *(*open)(uint16_t pid, const cdc_acm_host_device_config_t *dev_config, uint8_t interface_idx); /*!< Factory method of this driver */
-        uint16_t vid;                                                                                               /*!< VID this driver supports */
-        std::vector<uint16_t> pids;                                                                                 /*!< List of PIDs this driver supports */
-        vcp_driver(auto open_func, const uint16_t _vid, const std::vector<uint16_t> &_pids): open(open_func), vid(_vid), pids(_pids) {};
+        uint32_t id;      /*!< VID in the upper and PID in the lower 16 bits */
+        open_func_t open; /*!< Factory method of the driver */
     } vcp_driver;
 
     /**
-     * @brief List of registered VCP drivers
+     * @brief Add a VID/PID pair to the index
+     */
+    static void
+    add_driver(uint16_t _vid, uint16_t _pid, open_func_t open_func);
+
+    /**
+     * @brief Look up the driver of a VID/PID pair
+     *
+     * @return Driver, nullptr if no registered driver supports the device
+     */
+    static const vcp_driver *
+    find_driver(uint16_t _vid, uint16_t _pid);
+
+    /**
+     * @brief Index of registered VCP drivers, sorted by id for binary search
      */
     static std::vector<vcp_driver> drivers;
 }; // VCP class
@@ -17,10 +17,38 @@
 // Auto detect supported PIDs
 #define CP210X_PID_AUTO  (0)
 
+// Line status of embedded events, same bits as the 16550 LSR
+#define CP210X_LINE_OVERRUN (1 << 1) // Data was lost before this byte
+#define CP210X_LINE_PARITY  (1 << 2) // Byte was received with a parity error
+#define CP210X_LINE_FRAMING (1 << 3) // Byte was received with a framing error
+#define CP210X_LINE_BREAK   (1 << 4) // Break condition was detected
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+/**
+ * @brief Line errors found in the received data
+ */
+typedef struct {
+    uint32_t parity;  /*!< Bytes received with a parity error */
+    uint32_t framing; /*!< Bytes received with a framing error */
+    uint32_t overrun; /*!< Overruns, received data was lost */
+    uint32_t breaks;  /*!< Break conditions */
+} cp210x_line_errors_t;
+
+/**
+ * @brief Line error callback
+ *
+ * Called from the CDC-ACM driver task, before the data callback gets the data the error belongs to.
+ *
+ * @param[in] offset      Position of the byte in the data of the next data callback, can be the length of the data
+ *                        if the error comes without a byte (eg. a break)
+ * @param[in] line_status CP210X_LINE_* bits
+ * @param[in] user_arg    User's argument passed to open function
+ */
+typedef void (*cp210x_line_error_callback_t)(size_t offset, uint8_t line_status, void *user_arg);
+
 /**
  * @brief Open CP210x device
  *
@@ -35,6 +63,49 @@ extern "C" {
  */
 esp_err_t cp210x_vcp_open(uint16_t pid, uint8_t interface_idx, const cdc_acm_host_device_config_t *dev_config, cdc_acm_dev_hdl_t *cdc_hdl_ret);
 
+/**
+ * @brief Report line errors and modem status changes in the received data
+ *
+ * The device embeds line and modem status events in the data stream. The driver removes them from the received data,
+ * so the data callback only gets data bytes. Line errors are counted, passed to error_cb with their position and reported
+ * as CDC_ACM_HOST_SERIAL_STATE event once per received transfer. Modem status changes are reported as
+ * CDC_ACM_HOST_SERIAL_STATE event too. Error flags the device latched before are cleared.
+ *
+ * @param[in] cdc_hdl  CP210x handle
+ * @param[in] error_cb Line error callback, can be NULL
+ * @return
+ *    - ESP_OK: Success
+ *    - ESP_ERR_INVALID_ARG: Not a CP210x handle
+ *    - ESP_ERR_NO_MEM: No memory
+ *    - Error of the control transfer
+ */
+esp_err_t cp210x_vcp_embed_events_enable(cdc_acm_dev_hdl_t cdc_hdl, cp210x_line_error_callback_t error_cb);
+
+/**
+ * @brief Stop embedding events in the received data
+ *
+ * @param[in] cdc_hdl CP210x handle
+ * @return
+ *    - ESP_OK: Success
+ *    - ESP_ERR_INVALID_ARG: Not a CP210x handle
+ *    - Error of the control transfer
+ */
+esp_err_t cp210x_vcp_embed_events_disable(cdc_acm_dev_hdl_t cdc_hdl);
+
+/**
+ * @brief Get the line errors counted since embedded events were first enabled
+ *
+ * No USB traffic, the errors are counted while the received data is decoded.
+ *
+ * @param[in]  cdc_hdl    CP210x handle
+ * @param[out] errors_ret Line errors
+ * @return
+ *    - ESP_OK: Success
+ *    - ESP_ERR_INVALID_ARG: Not a CP210x handle
+ *    - ESP_ERR_INVALID_STATE: Embedded events were never enabled
+ */
+esp_err_t cp210x_vcp_line_errors_get(cdc_acm_dev_hdl_t cdc_hdl, cp210x_line_errors_t *errors_ret);
+
 #ifdef __cplusplus
 }
 #endif
@@ -38,6 +38,38 @@ public:
         }
     };
 
+    /**
+     * @brief Report line errors and modem status changes in the received data
+     *
+     * @see cp210x_vcp_embed_events_enable
+     * @param[in] error_cb Line error callback, can be nullptr
+     * @return esp_err_t
+     */
+    inline esp_err_t embed_events_enable(cp210x_line_error_callback_t error_cb = nullptr)
+    {
+        return cp210x_vcp_embed_events_enable(this->cdc_hdl, error_cb);
+    }
+
+    /**
+     * @brief Stop embedding events in the received data
+     *
+     * @return esp_err_t
+     */
+    inline esp_err_t embed_events_disable()
+    {
+        return cp210x_vcp_embed_events_disable(this->cdc_hdl);
+    }
+
+    /**
+     * @brief Get the line errors counted since embedded events were first enabled, without USB traffic
+     *
+     * @param[out] errors Line errors
+     * @return esp_err_t
+     */
+    inline esp_err_t line_errors(cp210x_line_errors_t *errors)
+    {
+        return cp210x_vcp_line_errors_get(this->cdc_hdl, errors);
+    }
 
     // List of supported VIDs and PIDs
     static constexpr uint16_t vid = SILICON_LABS_VID;
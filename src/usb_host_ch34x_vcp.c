@@ -4,12 +4,14 @@
  * SPDX-License-Identifier: Apache-2.0
  */
 
+#include <inttypes.h>
 #include "esp_check.h"
 #include "esp_bit_defs.h"
 #include "usb/usb_types_ch9.h"
 #include "usb/cdc_acm_host.h"
 #include "esp_private/cdc_host_common.h"
 #include "usb/vcp_ch34x.h"
+#include "usb/vcp_baudrate.h"
 
 #define CH34X_READ_REQ  (USB_BM_REQUEST_TYPE_TYPE_VENDOR | USB_BM_REQUEST_TYPE_RECIP_DEVICE | USB_BM_REQUEST_TYPE_DIR_IN)
 #define CH34X_WRITE_REQ (USB_BM_REQUEST_TYPE_TYPE_VENDOR | USB_BM_REQUEST_TYPE_RECIP_DEVICE | USB_BM_REQUEST_TYPE_DIR_OUT)
@@ -39,10 +41,6 @@
 #define CH34X_UART_RECV_ERROR 0x02
 #define CH34X_UART_STATE_TRANSIENT_MASK 0x07
 
-//CH34x Baud Rate
-#define CH34x_BAUDRATE_FACTOR 1532620800
-#define CH34x_BAUDRATE_DIVMAX 3
-
 // Line Coding Register (LCR)
 #define CH34x_REG_LCR          0x18
 #define CH34x_LCR_ENABLE_RX    0x80
@@ -58,58 +56,6 @@
 
 static const char *TAG = "CH34x";
 
-static int calculate_baud_divisor(unsigned int baud_rate, unsigned char *factor, unsigned char *divisor)
-{
-    unsigned char a;
-    unsigned char b;
-    unsigned long c;
-
-    assert(factor);
-    assert(divisor);
-
-    switch (baud_rate) {
-    case 921600:
-        a = 0xf3;
-        b = 7;
-        break;
-    case 307200:
-        a = 0xd9;
-        b = 7;
-        break;
-    default:
-        if (baud_rate > 6000000 / 255) {
-            b = 3;
-            c = 6000000;
-        } else if (baud_rate > 750000 / 255) {
-            b = 2;
-            c = 750000;
-        } else if (baud_rate > 93750 / 255) {
-            b = 1;
-            c = 93750;
-        } else {
-            b = 0;
-            c = 11719;
-        }
-
-        a = (unsigned char)(c / baud_rate);
-        if (a == 0 || a == 0xFF) {
-            return -1; // Can't set required baud rate
-        }
-        // Deal with integer division
-        const int delta_0 = c / a - baud_rate;
-        const int delta_1 = baud_rate - c / (a + 1);
-        if (delta_0 > delta_1) {
-            a++;
-        }
-        a = 256 - a;
-        break;
-    }
-
-    *factor = a;
-    *divisor = b;
-    return 0;
-}
-
 // This is implementation of USB CDC-ACM compliant functions.
 // It strictly follows interface defined in interface/usb/cdc_acm_host_inteface.h
 static esp_err_t ch34x_set_control_line_state(cdc_acm_dev_hdl_t cdc_hdl, bool dtr, bool rts)
@@ -130,12 +76,12 @@ static esp_err_t ch34x_line_coding_set(cdc_acm_dev_hdl_t cdc_hdl, const cdc_acm_
 
     // Baudrate
     if (line_coding->dwDTERate != 0) {
-        uint8_t factor, divisor;
-        if (calculate_baud_divisor(line_coding->dwDTERate, &factor, &divisor) != 0) {
+        if (line_coding->dwDTERate < VCP_BAUD_CH34X_MIN || line_coding->dwDTERate > VCP_BAUD_CH34X_MAX) {
             return ESP_ERR_INVALID_ARG;
         }
-        uint16_t baud_reg_val = (factor << 8) | divisor;
-        baud_reg_val |= BIT7;
+        const vcp_baud_divisor_t div = vcp_baud_divisor_get(VCP_BAUD_CH34X, line_coding->dwDTERate);
+        uint16_t baud_reg_val = div.reg | BIT7;
+        ESP_LOGD(TAG, "Baudrate required: %" PRIu32 ", set: %" PRIu32, line_coding->dwDTERate, div.baudrate);
         ESP_RETURN_ON_ERROR(cdc_acm_host_send_custom_request(cdc_hdl, CH34X_WRITE_REQ, CH34X_CMD_WRITE, 0x1312, baud_reg_val, 0, NULL), TAG, "Set baudrate failed");
     }
 
@@ -194,29 +140,72 @@ static esp_err_t ch34x_line_coding_set(cdc_acm_dev_hdl_t cdc_hdl, const cdc_acm_
     return ESP_OK;
 }
 
+/**
+ * @brief Decode a packet of the interrupt IN endpoint
+ *
+ * Byte 0 holds the line errors, byte 2 the modem status lines (active low). Packets are sent when the state changes,
+ * so CTS, DSR, RING and DCD are known without polling them with control transfers.
+ */
+static bool ch34x_notif_decode(cdc_acm_dev_hdl_t cdc_hdl, const uint8_t *data, size_t data_len, cdc_acm_uart_state_t *serial_state)
+{
+    if (data_len < 4) {
+        return false;
+    }
+    const uint8_t modem = ~data[2];
+    const uint8_t line = data[CH34X_UART_STATE] & CH34X_UART_STATE_TRANSIENT_MASK;
+
+    serial_state->val = 0;
+    serial_state->bCts = (modem & CH34X_UART_CTS) != 0;
+    serial_state->bTxCarrier = (modem & CH34X_UART_DSR) != 0;
+    serial_state->bRingSignal = (modem & CH34X_UART_RING) != 0;
+    serial_state->bRxCarrier = (modem & CH34X_UART_DCD) != 0;
+    serial_state->bFraming = (line & CH34X_UART_FRAME_ERROR) == CH34X_UART_FRAME_ERROR;
+    serial_state->bParity = !serial_state->bFraming && (line & CH34X_UART_PARITY_ERROR) != 0;
+    serial_state->bOverRun = (line & CH34X_UART_OVERRUN_ERROR) != 0;
+    return true;
+}
+
+// CH342, CH343, CH344 and CH9102 are CDC-ACM compliant, with an interface pair per port
+static bool ch34x_is_cdc_compliant(uint16_t pid)
+{
+    return pid == CH342_PID || pid == CH343_PID || pid == CH9102_PID || pid == CH344_PID;
+}
+
+static esp_err_t ch34x_open_pid(uint16_t pid, uint8_t interface_idx, const cdc_acm_host_device_config_t *dev_config, cdc_acm_dev_hdl_t *cdc_hdl_ret)
+{
+    if (ch34x_is_cdc_compliant(pid)) {
+        // Default CDC-ACM functions, the chip calculates the baudrate divisor
+        return cdc_acm_host_open(NANJING_QINHENG_MICROE_VID, pid, 2 * interface_idx, dev_config, cdc_hdl_ret);
+    }
+
+    const esp_err_t ret = cdc_acm_host_open(NANJING_QINHENG_MICROE_VID, pid, interface_idx, dev_config, cdc_hdl_ret);
+
+    // Set custom function for this driver
+    if (ret == ESP_OK) {
+        cdc_acm_dev_hdl_t cdc_hdl = *cdc_hdl_ret;
+        cdc_hdl->intf_func.line_coding_set = ch34x_line_coding_set;
+        cdc_hdl->intf_func.set_control_line_state = ch34x_set_control_line_state;
+        cdc_hdl->intf_func.notif_decode = ch34x_notif_decode;
+    }
+    return ret;
+}
+
 esp_err_t ch34x_vcp_open(uint16_t pid, uint8_t interface_idx, const cdc_acm_host_device_config_t *dev_config, cdc_acm_dev_hdl_t *cdc_hdl_ret)
 {
     esp_err_t ret;
     if (pid == CH34X_PID_AUTO) {
-        static const uint16_t supported_pids[] = {CH340_PID, CH340_PID_1, CH341_PID};
+        static const uint16_t supported_pids[] = {CH340_PID, CH340_PID_1, CH341_PID, CH342_PID, CH343_PID, CH9102_PID, CH344_PID};
         static const size_t num_pids = sizeof(supported_pids) / sizeof(supported_pids[0]);
 
         ret = ESP_ERR_NOT_FOUND;
         for (size_t i = 0; i < num_pids; i++) {
-            ret = cdc_acm_host_open(NANJING_QINHENG_MICROE_VID, supported_pids[i], interface_idx, dev_config, cdc_hdl_ret);
+            ret = ch34x_open_pid(supported_pids[i], interface_idx, dev_config, cdc_hdl_ret);
             if (ret == ESP_OK) {
                 break;
             }
         }
     } else {
-        ret = cdc_acm_host_open(NANJING_QINHENG_MICROE_VID, pid, interface_idx, dev_config, cdc_hdl_ret);
-    }
-
-    // Set custom function for this driver
-    if (ret == ESP_OK) {
-        cdc_acm_dev_hdl_t cdc_hdl = *cdc_hdl_ret;
-        cdc_hdl->intf_func.line_coding_set = ch34x_line_coding_set;
-        cdc_hdl->intf_func.set_control_line_state = ch34x_set_control_line_state;
+        ret = ch34x_open_pid(pid, interface_idx, dev_config, cdc_hdl_ret);
     }
     return ret;
 }
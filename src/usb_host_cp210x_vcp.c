@@ -4,7 +4,10 @@
  * SPDX-License-Identifier: Apache-2.0
  */
 
+#include <inttypes.h>
+#include <stdlib.h>
 #include "esp_check.h"
+#include "freertos/FreeRTOS.h"
 #include "usb/usb_types_ch9.h"
 #include "usb/cdc_acm_host.h"
 #include "esp_private/cdc_host_common.h"
@@ -44,7 +47,53 @@
 #define CP210X_CMD_SET_CHARS       (0x19) // Set special characters
 #define CP210X_CMD_VENDOR_SPECIFIC (0xFF) // Read/write latch values
 
+// Embedded events, @see AN571 chapter 5.23
+// The device sends ESC 0x00 for a data byte equal to ESC, ESC 0x01 LSR DATA for a data byte with line errors,
+// ESC 0x02 LSR for line errors without data and ESC 0x03 MSR for a modem status change
+#define CP210X_EMBED_ESC           (0xEC) // Rarely in text data, so it seldom needs escaping
+#define CP210X_EMBED_DATA_ESC      (0x00)
+#define CP210X_EMBED_LSR_DATA      (0x01)
+#define CP210X_EMBED_LSR           (0x02)
+#define CP210X_EMBED_MSR           (0x03)
+#define CP210X_LINE_ERRORS         (CP210X_LINE_OVERRUN | CP210X_LINE_PARITY | CP210X_LINE_FRAMING | CP210X_LINE_BREAK)
+
+// Modem status bits of the MSR event
+#define CP210X_MSR_CTS             (1 << 4)
+#define CP210X_MSR_DSR             (1 << 5)
+#define CP210X_MSR_RI              (1 << 6)
+#define CP210X_MSR_DCD             (1 << 7)
+
+// Reply to CP210X_CMD_GET_COMM_STATUS
+typedef struct {
+    uint32_t ulErrors;
+    uint32_t ulHoldReasons;
+    uint32_t ulAmountInInQueue;
+    uint32_t ulAmountInOutQueue;
+    uint8_t bEofReceived;
+    uint8_t bWaitForImmediate;
+    uint8_t bReserved;
+} __attribute__((packed)) cp210x_comm_status_t;
+
+// Position in an embedded event, kept between IN transfers
+typedef enum {
+    CP210X_EMBED_STATE_DATA = 0,
+    CP210X_EMBED_STATE_ESC,
+    CP210X_EMBED_STATE_LSR_DATA, // LSR of ESC 0x01, followed by the data byte
+    CP210X_EMBED_STATE_DATA_LSR, // Data byte of ESC 0x01
+    CP210X_EMBED_STATE_LSR,
+    CP210X_EMBED_STATE_MSR,
+} cp210x_embed_state_t;
+
+// Embedded events state of an open device, in intf_ctx
+typedef struct {
+    cp210x_embed_state_t state;
+    uint8_t lsr;                          // LSR of the pending ESC 0x01 event
+    cp210x_line_error_callback_t error_cb;
+    cp210x_line_errors_t errors;
+} cp210x_embed_t;
+
 static const char *TAG = "CP210x";
+static portMUX_TYPE cp210x_lock = portMUX_INITIALIZER_UNLOCKED; // Protects the line error counters
 
 // This is implementation of USB CDC-ACM compliant functions.
 // It strictly follows interface defined in interface/usb/cdc_acm_host_inteface.h
@@ -72,6 +121,8 @@ static esp_err_t cp210x_line_coding_set(cdc_acm_dev_hdl_t cdc_hdl, const cdc_acm
     assert(line_coding);
 
     if (line_coding->dwDTERate != 0) {
+        // The chip picks the rate itself, from a divisor or a fixed table depending on the part
+        ESP_LOGD(TAG, "Baudrate required: %" PRIu32, line_coding->dwDTERate);
         ESP_RETURN_ON_ERROR(
             cdc_acm_host_send_custom_request(
                 cdc_hdl, CP210X_WRITE_REQ, CP210X_CMD_SET_BAUDRATE, 0, cdc_hdl->data.intf_desc->bInterfaceNumber, sizeof(line_coding->dwDTERate), (uint8_t *)&line_coding->dwDTERate), TAG,);
@@ -99,6 +150,137 @@ static esp_err_t cp210x_send_break(cdc_acm_dev_hdl_t cdc_hdl, uint16_t duration_
     return cdc_acm_host_send_custom_request(cdc_hdl, CP210X_WRITE_REQ, CP210X_CMD_SET_BREAK, 0, cdc_hdl->data.intf_desc->bInterfaceNumber, 0, NULL);
 }
 
+/**
+ * @brief Count a line error and pass it to the user
+ *
+ * @param[in] cdc_hdl CP210x handle
+ * @param[in] embed   Embedded events state
+ * @param[in] offset  Position in the decoded data
+ * @param[in] lsr     Line status of the event
+ * @return Line error bits of lsr
+ */
+static uint8_t cp210x_line_error(cdc_acm_dev_hdl_t cdc_hdl, cp210x_embed_t *embed, size_t offset, uint8_t lsr)
+{
+    lsr &= CP210X_LINE_ERRORS;
+    if (lsr == 0) {
+        return 0;
+    }
+    portENTER_CRITICAL(&cp210x_lock);
+    embed->errors.parity += (lsr & CP210X_LINE_PARITY) != 0;
+    embed->errors.framing += (lsr & CP210X_LINE_FRAMING) != 0;
+    embed->errors.overrun += (lsr & CP210X_LINE_OVERRUN) != 0;
+    embed->errors.breaks += (lsr & CP210X_LINE_BREAK) != 0;
+    portEXIT_CRITICAL(&cp210x_lock);
+    if (embed->error_cb) {
+        embed->error_cb(offset, lsr, cdc_hdl->cb_arg);
+    }
+    return lsr;
+}
+
+/**
+ * @brief Send a serial state event to the user
+ */
+static void cp210x_serial_state_notify(cdc_acm_dev_hdl_t cdc_hdl, cdc_acm_uart_state_t serial_state)
+{
+    if (cdc_hdl->notif.cb) {
+        const cdc_acm_host_dev_event_data_t serial_state_event = {
+            .type = CDC_ACM_HOST_SERIAL_STATE,
+            .data.serial_state = serial_state
+        };
+        cdc_hdl->notif.cb(&serial_state_event, cdc_hdl->cb_arg);
+    }
+}
+
+/**
+ * @brief Remove embedded events from received data
+ *
+ * Single pass: data bytes are moved to the front of the buffer as the events are removed.
+ * An event can be split between two IN transfers.
+ */
+static size_t cp210x_rx_decode(cdc_acm_dev_hdl_t cdc_hdl, uint8_t *data, size_t data_len)
+{
+    cp210x_embed_t *embed = (cp210x_embed_t *)cdc_hdl->intf_ctx;
+    size_t out = 0;
+    uint8_t line_errors = 0;
+    uint8_t msr = 0;
+    bool msr_received = false;
+
+    for (size_t in = 0; in < data_len; in++) {
+        const uint8_t c = data[in];
+        switch (embed->state) {
+        case CP210X_EMBED_STATE_DATA:
+            if (c == CP210X_EMBED_ESC) {
+                embed->state = CP210X_EMBED_STATE_ESC;
+            } else {
+                data[out++] = c;
+            }
+            break;
+        case CP210X_EMBED_STATE_ESC:
+            switch (c) {
+            case CP210X_EMBED_DATA_ESC:
+                data[out++] = CP210X_EMBED_ESC;
+                embed->state = CP210X_EMBED_STATE_DATA;
+                break;
+            case CP210X_EMBED_LSR_DATA:
+                embed->state = CP210X_EMBED_STATE_LSR_DATA;
+                break;
+            case CP210X_EMBED_LSR:
+                embed->state = CP210X_EMBED_STATE_LSR;
+                break;
+            case CP210X_EMBED_MSR:
+                embed->state = CP210X_EMBED_STATE_MSR;
+                break;
+            default:
+                ESP_LOGW(TAG, "Malformed event 0x%02X", c);
+                embed->state = CP210X_EMBED_STATE_DATA;
+                break;
+            }
+            break;
+        case CP210X_EMBED_STATE_LSR_DATA:
+            embed->lsr = c;
+            embed->state = CP210X_EMBED_STATE_DATA_LSR;
+            break;
+        case CP210X_EMBED_STATE_DATA_LSR:
+            line_errors |= cp210x_line_error(cdc_hdl, embed, out, embed->lsr);
+            data[out++] = c;
+            embed->state = CP210X_EMBED_STATE_DATA;
+            break;
+        case CP210X_EMBED_STATE_LSR:
+            line_errors |= cp210x_line_error(cdc_hdl, embed, out, c);
+            embed->state = CP210X_EMBED_STATE_DATA;
+            break;
+        case CP210X_EMBED_STATE_MSR:
+            msr = c;
+            msr_received = true;
+            embed->state = CP210X_EMBED_STATE_DATA;
+            break;
+        }
+    }
+
+    if (msr_received) {
+        // Only the last modem status of the transfer is reported
+        cdc_acm_uart_state_t serial_state = cdc_hdl->serial_state;
+        serial_state.bCts = (msr & CP210X_MSR_CTS) != 0;
+        serial_state.bTxCarrier = (msr & CP210X_MSR_DSR) != 0;
+        serial_state.bRingSignal = (msr & CP210X_MSR_RI) != 0;
+        serial_state.bRxCarrier = (msr & CP210X_MSR_DCD) != 0;
+        if (serial_state.val != cdc_hdl->serial_state.val) {
+            cdc_hdl->serial_state = serial_state;
+            cp210x_serial_state_notify(cdc_hdl, serial_state);
+        }
+    }
+    if (line_errors) {
+        // Line errors are events, they are not kept in the serial state
+        cdc_acm_uart_state_t serial_state = cdc_hdl->serial_state;
+        serial_state.bOverRun = (line_errors & CP210X_LINE_OVERRUN) != 0;
+        serial_state.bParity = (line_errors & CP210X_LINE_PARITY) != 0;
+        serial_state.bFraming = (line_errors & CP210X_LINE_FRAMING) != 0;
+        serial_state.bBreak = (line_errors & CP210X_LINE_BREAK) != 0;
+        cp210x_serial_state_notify(cdc_hdl, serial_state);
+    }
+    return out;
+}
+
 esp_err_t cp210x_vcp_open(uint16_t pid, uint8_t interface_idx, const cdc_acm_host_device_config_t *dev_config, cdc_acm_dev_hdl_t *cdc_hdl_ret)
 {
     esp_err_t ret;
@@ -134,3 +316,58 @@ esp_err_t cp210x_vcp_open(uint16_t pid, uint8_t interface_idx, const cdc_acm_hos
     }
     return ret;
 };
+
+esp_err_t cp210x_vcp_embed_events_enable(cdc_acm_dev_hdl_t cdc_hdl, cp210x_line_error_callback_t error_cb)
+{
+    ESP_RETURN_ON_FALSE(cdc_hdl && cdc_hdl->intf_func.line_coding_set == cp210x_line_coding_set, ESP_ERR_INVALID_ARG, TAG, "Not a CP210x");
+
+    // Reading the comm status clears the error flags the device latched so far
+    cp210x_comm_status_t comm_status;
+    ESP_RETURN_ON_ERROR(
+        cdc_acm_host_send_custom_request(
+            cdc_hdl, CP210X_READ_REQ, CP210X_CMD_GET_COMM_STATUS, 0, cdc_hdl->data.intf_desc->bInterfaceNumber, sizeof(comm_status), (uint8_t *)&comm_status), TAG,);
+    if (comm_status.ulErrors != 0) {
+        ESP_LOGD(TAG, "Errors before embedded events: 0x%02" PRIX32, comm_status.ulErrors);
+    }
+
+    cp210x_embed_t *embed = (cp210x_embed_t *)cdc_hdl->intf_ctx;
+    if (!embed) {
+        embed = calloc(1, sizeof(cp210x_embed_t));
+        ESP_RETURN_ON_FALSE(embed, ESP_ERR_NO_MEM, TAG, "No memory");
+        cdc_hdl->intf_ctx = embed;
+    }
+    embed->state = CP210X_EMBED_STATE_DATA;
+    embed->error_cb = error_cb;
+    // Decode from now on: until the device gets the request, an ESC data byte is taken for an event
+    cdc_hdl->intf_func.rx_decode = cp210x_rx_decode;
+
+    const esp_err_t ret = cdc_acm_host_send_custom_request(cdc_hdl, CP210X_WRITE_REQ, CP210X_CMD_EMBED_EVENTS, CP210X_EMBED_ESC, cdc_hdl->data.intf_desc->bInterfaceNumber, 0, NULL);
+    if (ret != ESP_OK) {
+        cdc_hdl->intf_func.rx_decode = NULL;
+    }
+    return ret;
+}
+
+esp_err_t cp210x_vcp_embed_events_disable(cdc_acm_dev_hdl_t cdc_hdl)
+{
+    ESP_RETURN_ON_FALSE(cdc_hdl && cdc_hdl->intf_func.line_coding_set == cp210x_line_coding_set, ESP_ERR_INVALID_ARG, TAG, "Not a CP210x");
+
+    ESP_RETURN_ON_ERROR(
+        cdc_acm_host_send_custom_request(
+            cdc_hdl, CP210X_WRITE_REQ, CP210X_CMD_EMBED_EVENTS, 0, cdc_hdl->data.intf_desc->bInterfaceNumber, 0, NULL), TAG,);
+    cdc_hdl->intf_func.rx_decode = NULL;
+    return ESP_OK;
+}
+
+esp_err_t cp210x_vcp_line_errors_get(cdc_acm_dev_hdl_t cdc_hdl, cp210x_line_errors_t *errors_ret)
+{
+    ESP_RETURN_ON_FALSE(cdc_hdl && cdc_hdl->intf_func.line_coding_set == cp210x_line_coding_set, ESP_ERR_INVALID_ARG, TAG, "Not a CP210x");
+    ESP_RETURN_ON_FALSE(errors_ret, ESP_ERR_INVALID_ARG, TAG, "errors_ret is NULL");
+    const cp210x_embed_t *embed = (const cp210x_embed_t *)cdc_hdl->intf_ctx;
+    ESP_RETURN_ON_FALSE(embed, ESP_ERR_INVALID_STATE, TAG, "Embedded events were never enabled");
+
+    portENTER_CRITICAL(&cp210x_lock);
+    *errors_ret = embed->errors;
+    portEXIT_CRITICAL(&cp210x_lock);
+    return ESP_OK;
+}
@@ -7,7 +7,9 @@
 #include <string.h>
 #include <inttypes.h>
 #include "usb/vcp_ftdi.hpp"
+#include "usb/vcp_baudrate.h"
 #include "usb/usb_types_ch9.h"
+#include "esp_private/cdc_host_common.h"
 #include "esp_log.h"
 #include "esp_check.h"
 #include "sdkconfig.h"
@@ -19,10 +21,15 @@
 #define FTDI_READ_REQ  (USB_BM_REQUEST_TYPE_TYPE_VENDOR | USB_BM_REQUEST_TYPE_DIR_IN)
 #define FTDI_WRITE_REQ (USB_BM_REQUEST_TYPE_TYPE_VENDOR | USB_BM_REQUEST_TYPE_DIR_OUT)
 
+// FTDI settings in cdc_line_state_t.vendor
+#define FTDI_STATE_LATENCY    (0)
+#define FTDI_STATE_EVENT_CHAR (1)
+
 namespace esp_usb {
 FT23x::FT23x(uint16_t pid, const cdc_acm_host_device_config_t *dev_config, uint8_t interface_idx)
-    : intf(interface_idx), user_data_cb(dev_config->data_cb), user_event_cb(dev_config->event_cb),
-      user_arg(dev_config->user_arg), uart_state(0)
+    : intf(interface_idx), multi_port(pid == FT2232_PID || pid == FT4232H_PID), hs_clock(false),
+      hx_series(pid == FT2232_PID || pid == FT4232H_PID || pid == FT231_PID), user_data_cb(dev_config->data_cb), user_event_cb(dev_config->event_cb),
+      user_arg(dev_config->user_arg), uart_state(0), in_mps(64)
 {
     cdc_acm_host_device_config_t ftdi_config;
     memcpy(&ftdi_config, dev_config, sizeof(cdc_acm_host_device_config_t));
@@ -45,62 +52,146 @@ FT23x::FT23x(uint16_t pid, const cdc_acm_host_device_config_t *dev_config, uint8
         throw (err);
     }
 
-    // FT23x interface must be first reset and configured (115200 8N1)
-    err = this->send_custom_request(FTDI_WRITE_REQ, FTDI_CMD_RESET, 0, this->intf + 1, 0, NULL);
-    if (err != ESP_OK) {
-        throw (err);
+    // Full speed packet size is used until here. The device only sends status packets before it is configured below
+    // High-speed chips use 512 byte packets when they are connected to a high-speed host
+    uint16_t mps = 0;
+    cdc_acm_host_data_mps_get(this->cdc_hdl, &mps, NULL);
+    if (mps != 0) {
+        this->in_mps = mps;
     }
 
-    cdc_acm_line_coding_t line_coding = {
-        .dwDTERate = 115200,
-        .bCharFormat = 0,
-        .bParityType = 0,
-        .bDataBits = 8,
-    };
-    err = this->line_coding_set(&line_coding);
-    if (err != ESP_OK) {
-        throw (err);
+    // FT2232D and FT2232H share their PID, the chip type is in bcdDevice
+    const usb_device_desc_t *device_desc;
+    if (this->device_info(&device_desc, NULL) == ESP_OK) {
+        const uint16_t chip = device_desc->bcdDevice & 0xFF00;
+        this->hs_clock = (chip == 0x0700) || (chip == 0x0800) || (chip == 0x0900); // FT2232H, FT4232H, FT232H
+        this->hx_series = this->hx_series || this->hs_clock;
+    }
+
+    // Reset the port only when nothing is known about it. A reopened port keeps the settings the driver remembers
+    const cdc_line_state_t *state = &this->cdc_hdl->line_state;
+    const bool known = state->line_coding.dwDTERate != 0 || state->line_coding.bDataBits != 0 ||
+                       state->ctrl_lines_valid || state->vendor_valid != 0;
+    if (!known) {
+        err = this->send_custom_request(FTDI_WRITE_REQ, FTDI_CMD_RESET, 0, this->intf + 1, 0, NULL);
+        if (err != ESP_OK) {
+            throw (err);
+        }
     }
 };
 
 esp_err_t FT23x::line_coding_set(cdc_acm_line_coding_t *line_coding)
 {
     assert(line_coding);
-
-    if (line_coding->dwDTERate != 0) {
-        uint16_t wIndex, wValue;
-        calculate_baudrate(line_coding->dwDTERate, &wValue, &wIndex);
+    cdc_acm_line_coding_t *coding = &this->cdc_hdl->line_state.line_coding;
+
+    if (line_coding->dwDTERate != 0 && line_coding->dwDTERate != coding->dwDTERate) {
+        const vcp_baud_divisor_t div = vcp_baud_divisor_get(this->hs_clock ? VCP_BAUD_FTDI_HS : VCP_BAUD_FTDI, line_coding->dwDTERate);
+        uint16_t wValue = div.reg & 0xFFFF;
+        uint16_t wIndex = div.reg >> 16;
+        if (this->hx_series) {
+            wIndex = (wIndex << 8) | this->port();
+        }
+        ESP_LOGD("FT23x", "wValue: 0x%04X wIndex: 0x%04X", wValue, wIndex);
+        ESP_LOGI("FT23x", "Baudrate required: %" PRIu32", set: %" PRIu32, line_coding->dwDTERate, div.baudrate);
+        coding->dwDTERate = 0; // Unknown until the device accepted it
         ESP_RETURN_ON_ERROR(this->send_custom_request(FTDI_WRITE_REQ, FTDI_CMD_SET_BAUDRATE, wValue, wIndex, 0, NULL), "FT23x",);
+        coding->dwDTERate = line_coding->dwDTERate;
     }
 
-    if (line_coding->bDataBits != 0) {
+    if (line_coding->bDataBits != 0 &&
+            (line_coding->bDataBits != coding->bDataBits ||
+             line_coding->bParityType != coding->bParityType ||
+             line_coding->bCharFormat != coding->bCharFormat)) {
         const uint16_t wValue = (line_coding->bDataBits) | (line_coding->bParityType << 8) | (line_coding->bCharFormat << 11);
-        return this->send_custom_request(FTDI_WRITE_REQ, FTDI_CMD_SET_LINE_CTL, wValue, this->intf, 0, NULL);
+        coding->bDataBits = 0;
+        ESP_RETURN_ON_ERROR(this->send_custom_request(FTDI_WRITE_REQ, FTDI_CMD_SET_LINE_CTL, wValue, this->port(), 0, NULL), "FT23x",);
+        coding->bDataBits = line_coding->bDataBits;
+        coding->bParityType = line_coding->bParityType;
+        coding->bCharFormat = line_coding->bCharFormat;
     }
     return ESP_OK;
 }
 
 esp_err_t FT23x::set_control_line_state(bool dtr, bool rts)
 {
-    ESP_RETURN_ON_ERROR(this->send_custom_request(FTDI_WRITE_REQ, FTDI_CMD_SET_MHS, dtr ? 0x11 : 0x10, this->intf, 0, NULL), "FT23x",); // DTR
-    return this->send_custom_request(FTDI_WRITE_REQ, FTDI_CMD_SET_MHS, rts ? 0x21 : 0x20, this->intf, 0, NULL); // RTS
+    cdc_line_state_t *state = &this->cdc_hdl->line_state;
+    const bool known = state->ctrl_lines_valid;
+    state->ctrl_lines_valid = false; // Unknown until the device accepted both
+    if (!known || ((state->ctrl_lines & 0x01) != 0) != dtr) {
+        ESP_RETURN_ON_ERROR(this->send_custom_request(FTDI_WRITE_REQ, FTDI_CMD_SET_MHS, dtr ? 0x11 : 0x10, this->port(), 0, NULL), "FT23x",); // DTR
+    }
+    if (!known || ((state->ctrl_lines & 0x02) != 0) != rts) {
+        ESP_RETURN_ON_ERROR(this->send_custom_request(FTDI_WRITE_REQ, FTDI_CMD_SET_MHS, rts ? 0x21 : 0x20, this->port(), 0, NULL), "FT23x",); // RTS
+    }
+    state->ctrl_lines = (dtr ? 0x01 : 0) | (rts ? 0x02 : 0);
+    state->ctrl_lines_valid = true;
+    return ESP_OK;
+}
+
+esp_err_t FT23x::vendor_setting_set(uint8_t idx, uint8_t request, uint16_t wValue)
+{
+    cdc_line_state_t *state = &this->cdc_hdl->line_state;
+    const uint8_t bit = 1 << idx;
+    if ((state->vendor_valid & bit) && state->vendor[idx] == wValue) {
+        return ESP_OK;
+    }
+    state->vendor_valid &= ~bit;
+    ESP_RETURN_ON_ERROR(this->send_custom_request(FTDI_WRITE_REQ, request, wValue, this->port(), 0, NULL), "FT23x",);
+    state->vendor[idx] = wValue;
+    state->vendor_valid |= bit;
+    return ESP_OK;
+}
+
+esp_err_t FT23x::set_latency_timer(uint8_t latency_ms)
+{
+    ESP_RETURN_ON_FALSE(latency_ms != 0, ESP_ERR_INVALID_ARG, "FT23x", "latency must be 1 - 255 ms");
+    return this->vendor_setting_set(FTDI_STATE_LATENCY, FTDI_CMD_SET_LATENCY_TIMER, latency_ms);
+}
+
+esp_err_t FT23x::set_event_char(uint8_t event_char, bool enable)
+{
+    const uint16_t wValue = event_char | (enable ? 0x100 : 0); // Bit 8 enables the event character
+    return this->vendor_setting_set(FTDI_STATE_EVENT_CHAR, FTDI_CMD_SET_EVENT_CHAR, wValue);
 }
 
 bool FT23x::ftdi_rx(const uint8_t *data, size_t data_len, void *user_arg)
 {
     FT23x *this_ftdi = (FT23x *)user_arg;
+    if (data_len < 2) {
+        return true;
+    }
+
+    // Move the payload of every following packet up against the payload of the first one
+    // The data buffer belongs to the IN transfer, so it can be modified in place
+    uint8_t *const buf = const_cast<uint8_t *>(data);
+    const size_t mps = this_ftdi->in_mps;
+    const uint8_t *status = data;
+    uint8_t line_errors = 0;
+    size_t end = (data_len < mps) ? data_len : mps;
+    for (size_t pkt = mps; pkt < data_len; pkt += mps) {
+        line_errors |= status[1];
+        status = &data[pkt];
+        const size_t pkt_len = ((data_len - pkt) < mps) ? (data_len - pkt) : mps;
+        if (pkt_len > 2) {
+            memmove(&buf[end], &data[pkt + 2], pkt_len - 2);
+            end += pkt_len - 2;
+        }
+    }
+    line_errors |= status[1];
 
     // Dispatch serial state if it has changed
     if (this_ftdi->user_event_cb) {
         cdc_acm_uart_state_t new_state;
         new_state.val = 0;
-        new_state.bRxCarrier =  data[0] & 0x80; // DCD
-        new_state.bTxCarrier =  data[0] & 0x20; // DSR
-        new_state.bBreak =      data[1] & 0x10;
-        new_state.bRingSignal = data[0] & 0x40;
-        new_state.bFraming =    data[1] & 0x08;
-        new_state.bParity =     data[1] & 0x04;
-        new_state.bOverRun =    data[1] & 0x02;
+        new_state.bRxCarrier =  (status[0] & 0x80) != 0; // DCD
+        new_state.bTxCarrier =  (status[0] & 0x20) != 0; // DSR
+        new_state.bBreak =      (line_errors & 0x10) != 0;
+        new_state.bRingSignal = (status[0] & 0x40) != 0;
+        new_state.bFraming =    (line_errors & 0x08) != 0;
+        new_state.bParity =     (line_errors & 0x04) != 0;
+        new_state.bOverRun =    (line_errors & 0x02) != 0;
+        new_state.bCts =        (status[0] & 0x10) != 0;
 
         if (this_ftdi->uart_state != new_state.val) {
             cdc_acm_host_dev_event_data_t serial_event;
@@ -112,8 +203,8 @@ bool FT23x::ftdi_rx(const uint8_t *data, size_t data_len, void *user_arg)
     }
 
     // Dispatch data if any
-    if (data_len > 2) {
-        return this_ftdi->user_data_cb(&data[2], data_len - 2, this_ftdi->user_arg);
+    if (end > 2) {
+        return this_ftdi->user_data_cb(&data[2], end - 2, this_ftdi->user_arg);
     }
     return true;
 }
@@ -123,54 +214,4 @@ void FT23x::ftdi_event(const cdc_acm_host_dev_event_data_t *event, void *user_ct
     FT23x *this_ftdi = (FT23x *)user_ctx;
     this_ftdi->user_event_cb(event, this_ftdi->user_arg);
 }
-
-int FT23x::calculate_baudrate(uint32_t baudrate, uint16_t *wValue, uint16_t *wIndex)
-{
-#define FTDI_BASE_CLK (3000000)
-
-    int baudrate_real;
-    if (baudrate > 2000000) {
-        // set to 3000000
-        *wValue = 0;
-        *wIndex = 0;
-        baudrate_real = 3000000;
-    } else if (baudrate >= 1000000) {
-        // set to 1000000
-        *wValue = 1;
-        *wIndex = 0;
-        baudrate_real = 1000000;
-    } else {
-        const float ftdi_fractal[] = {0, 0.125, 0.25, 0.375, 0.5, 0.625, 0.75, 0.875, 1};
-        const uint8_t ftdi_fractal_bits[] = {0, 0x03, 0x02, 0x04, 0x01, 0x05, 0x06, 0x07};
-        uint16_t divider_n = FTDI_BASE_CLK / baudrate; // integer value
-        int ftdi_fractal_idx = 0;
-        float divider = FTDI_BASE_CLK / (float)baudrate; // float value
-        float divider_fractal = divider - (float)divider_n;
-
-        // Find closest bigger FT23x fractal divider
-        for (ftdi_fractal_idx = 0; ftdi_fractal[ftdi_fractal_idx] <= divider_fractal; ftdi_fractal_idx++) {};
-
-        // Calculate baudrate errors for two closest fractal divisors
-        int diff1 = baudrate - (int)(FTDI_BASE_CLK / (divider_n + ftdi_fractal[ftdi_fractal_idx]));     // Greater than required baudrate
-        int diff2 = (int)(FTDI_BASE_CLK / (divider_n + ftdi_fractal[ftdi_fractal_idx - 1])) - baudrate; // Lesser than required baudrate
-
-        // Chose divider and fractal divider with smallest error
-        if (diff2 < diff1) {
-            ftdi_fractal_idx--;
-        } else {
-            if (ftdi_fractal_idx == 8) {
-                ftdi_fractal_idx = 0;
-                divider_n++;
-            }
-        }
-
-        baudrate_real = FTDI_BASE_CLK / (float)((float)divider_n + ftdi_fractal[ftdi_fractal_idx]);
-        *wValue = ((0x3FFFF) & divider_n) | (ftdi_fractal_bits[ftdi_fractal_idx] << 14);
-        *wIndex = ftdi_fractal_bits[ftdi_fractal_idx] >> 2;
-    }
-    ESP_LOGD("FT23x", "wValue: 0x%04X wIndex: 0x%04X", *wValue, *wIndex);
-    ESP_LOGI("FT23x", "Baudrate required: %" PRIu32", set: %d", baudrate, baudrate_real);
-
-    return baudrate_real;
-}
 } // esp_usb
@@ -4,7 +4,9 @@
  * SPDX-License-Identifier: Apache-2.0
  */
 
+#include <algorithm>
 #include <stdexcept>
+#include <vector>
 #include "usb/vcp.hpp"
 #include "esp_log.h"
 #include "freertos/FreeRTOS.h"
@@ -14,6 +16,41 @@ static const char *TAG = "VCP service";
 
 namespace esp_usb {
 std::vector<VCP::vcp_driver> VCP::drivers;
+
+static inline uint32_t vcp_id(uint16_t vid, uint16_t pid)
+{
+    return ((uint32_t)vid << 16) | pid;
+}
+
+void VCP::add_driver(uint16_t _vid, uint16_t _pid, open_func_t open_func)
+{
+    const uint32_t id = vcp_id(_vid, _pid);
+    auto it = std::lower_bound(drivers.begin(), drivers.end(), id, [](const vcp_driver & drv, uint32_t key) {
+        return drv.id < key;
+    });
+    if (it != drivers.end() && it->id == id) {
+        return; // First registered driver wins
+    }
+    drivers.insert(it, vcp_driver{id, open_func});
+}
+
+const VCP::vcp_driver *VCP::find_driver(uint16_t _vid, uint16_t _pid)
+{
+    const uint32_t id = vcp_id(_vid, _pid);
+    auto it = std::lower_bound(drivers.begin(), drivers.end(), id, [](const vcp_driver & drv, uint32_t key) {
+        return drv.id < key;
+    });
+    if (it == drivers.end() || it->id != id) {
+        return nullptr;
+    }
+    return &(*it);
+}
+
+bool VCP::is_supported(uint16_t _vid, uint16_t _pid)
+{
+    return find_driver(_vid, _pid) != nullptr;
+}
+
 CdcAcmDevice *VCP::open(uint16_t _vid, uint16_t _pid, const cdc_acm_host_device_config_t *dev_config, uint8_t interface_idx)
 {
     // In case user didn't install CDC-ACM driver, we try to install it here.
@@ -24,24 +61,19 @@ CdcAcmDevice *VCP::open(uint16_t _vid, uint16_t _pid, const cdc_acm_host_device_
     default: ESP_LOGE(TAG, "Failed to install CDC-ACM driver"); return nullptr;
     }
 
-    for (vcp_driver drv : drivers) {
-        if (drv.vid == _vid) {
-            for (uint16_t p : drv.pids) {
-                if (p == _pid) {
-                    try {
-                        return drv.open(_pid, dev_config, interface_idx);
-                    } catch (esp_err_t &e) {
-                        switch (e) {
-                        case ESP_ERR_NO_MEM: throw std::bad_alloc();
-                        case ESP_ERR_NOT_FOUND: // fallthrough
-                        default: return nullptr;
-                        }
-                    }
-                }
-            }
+    const vcp_driver *drv = find_driver(_vid, _pid);
+    if (drv == nullptr) {
+        return nullptr;
+    }
+    try {
+        return drv->open(_pid, dev_config, interface_idx);
+    } catch (esp_err_t &e) {
+        switch (e) {
+        case ESP_ERR_NO_MEM: throw std::bad_alloc();
+        case ESP_ERR_NOT_FOUND: // fallthrough
+        default: return nullptr;
         }
     }
-    return nullptr;
 }
 
 CdcAcmDevice *VCP::open(const cdc_acm_host_device_config_t *dev_config, uint8_t interface_idx)
@@ -64,23 +96,34 @@ CdcAcmDevice *VCP::open(const cdc_acm_host_device_config_t *dev_config, uint8_t
     cdc_acm_host_device_config_t _config = *dev_config;
     _config.connection_timeout_ms = 1;
 
-    // Try opening all registered devices, return on first success
+    // Match the connected devices against the registered drivers, open the first supported one
+    // The ID list is on the heap, it is too big for the stack of the calling task
+    std::vector<uint32_t> ids(CDC_HOST_MAX_DEVICES);
     do {
-        for (vcp_driver drv : drivers) {
-            for (uint16_t pid : drv.pids) {
+        int num_of_devices = 0;
+        if (cdc_acm_host_device_ids_get(ids.size(), ids.data(), &num_of_devices) == ESP_OK) {
+            for (int i = 0; i < num_of_devices; i++) {
+                const uint16_t pid = ids[i] & 0xFFFF;
+                const vcp_driver *drv = find_driver(ids[i] >> 16, pid);
+                if (drv == nullptr) {
+                    continue;
+                }
                 try {
-                    return drv.open(pid, &_config, interface_idx);
+                    return drv->open(pid, &_config, interface_idx);
                 } catch (esp_err_t &e) {
                     switch (e) {
-                    case ESP_ERR_NOT_FOUND: break;
+                    case ESP_ERR_NOT_FOUND: break; // eg. the device is gone meanwhile
                     case ESP_ERR_NO_MEM: throw std::bad_alloc();
                     default: return nullptr;
                     }
                 }
             }
         }
+        if (xTaskCheckForTimeOut(&connection_timeout, &timeout_ticks) != pdFALSE) {
+            break; // Don't wait for the next poll when it would be past the timeout
+        }
         vTaskDelay(pdMS_TO_TICKS(50));
-    } while (xTaskCheckForTimeOut(&connection_timeout, &timeout_ticks) == pdFALSE);
+    } while (1);
     return nullptr;
 }
 } // namespace esp_usb